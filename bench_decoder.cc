@@ -0,0 +1,171 @@
+// Benchmark: vvdec latency profiles on this machine
+//   make bench && ./build/bench_decoder <bitstream.266> [profile|all] [threads]
+// Decodes the whole bitstream (preloaded, so file reads are not measured)
+// with each profile and reports decode throughput and per-frame latency,
+// measured from submitting a frame's slice to the frame coming out (the
+// encoder sends one slice per picture).
+// threads > 0 overrides the profile's thread count, as --decode_threads does.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "codec/decoder_profile.h"
+#include "tools/yuv_file_io.h"
+#include "vvdec/vvdec.h"
+
+// Large enough for any NAL unit of the streams this project sends
+static constexpr int kMaxNalSize = 8 << 20;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  uint64_t frames;
+  double seconds;
+  std::vector<double> latencies_ms;
+};
+
+// Split the bitstream into NAL units
+static bool LoadNalUnits(const std::string& path, std::vector<std::string>* nal_units) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "Failed to open %s\n", path.c_str());
+    return false;
+  }
+  vvdecAccessUnit* access_unit = vvdec_accessUnit_alloc();
+  vvdec_accessUnit_alloc_payload(access_unit, kMaxNalSize);
+  int read = 0;
+  while ((read = readBitstreamFromFile(&file, access_unit, false)) > 0) {
+    nal_units->emplace_back(reinterpret_cast<const char*>(access_unit->payload),
+                            access_unit->payloadUsedSize);
+  }
+  vvdec_accessUnit_free(access_unit);
+  return !nal_units->empty();
+}
+
+// Record an output frame's latency and release it
+static void TakeFrame(vvdecDecoder* decoder, vvdecFrame* frame,
+                      const std::vector<Clock::time_point>& submitted, Result* result) {
+  if (frame == nullptr) {
+    return;
+  }
+  if (frame->ctsValid && frame->cts < submitted.size()) {
+    result->latencies_ms.push_back(std::chrono::duration<double, std::milli>(
+                                       Clock::now() - submitted[frame->cts])
+                                       .count());
+  }
+  result->frames++;
+  vvdec_frame_unref(decoder, frame);
+}
+
+// Decode all NAL units with one profile
+// Returns false if the decoder fails
+static bool Decode(const std::vector<std::string>& nal_units, DecoderProfile profile,
+                   int threads, Result* result) {
+  vvdecParams params;
+  vvdec_params_default(&params);
+  params.logLevel = VVDEC_WARNING;
+  params.enable_realtime = true;
+  ApplyDecoderProfile(profile, threads, &params);
+  printf("%-18s threads=%d parseDelay=%d\n", DecoderProfileName(profile), params.threads,
+         params.parseDelay);
+
+  vvdecDecoder* decoder = vvdec_decoder_open(&params);
+  if (decoder == nullptr) {
+    fprintf(stderr, "Failed to open decoder\n");
+    return false;
+  }
+  vvdecAccessUnit* access_unit = vvdec_accessUnit_alloc();
+  vvdec_accessUnit_alloc_payload(access_unit, kMaxNalSize);
+
+  // cts is the index of the frame's slice, mapping outputs back to submit
+  // times
+  std::vector<Clock::time_point> submitted;
+  bool ok = true;
+  auto start = Clock::now();
+  for (const std::string& nal : nal_units) {
+    std::copy(nal.begin(), nal.end(), access_unit->payload);
+    access_unit->payloadUsedSize = static_cast<int>(nal.size());
+    bool slice = vvdec_is_nal_unit_slice(vvdec_get_nal_unit_type(access_unit));
+    if (slice) {
+      submitted.push_back(Clock::now());
+    }
+    access_unit->cts = submitted.empty() ? 0 : submitted.size() - 1;
+    access_unit->ctsValid = true;
+
+    vvdecFrame* frame = nullptr;
+    int ret = vvdec_decode(decoder, access_unit, &frame);
+    if (ret != VVDEC_OK && ret != VVDEC_TRY_AGAIN && ret != VVDEC_ERR_DEC_INPUT) {
+      fprintf(stderr, "Decoding failed: %s\n", vvdec_get_error_msg(ret));
+      ok = false;
+      break;
+    }
+    TakeFrame(decoder, frame, submitted, result);
+  }
+  for (;;) {
+    vvdecFrame* frame = nullptr;
+    if (vvdec_flush(decoder, &frame) != VVDEC_OK) {
+      break;
+    }
+    TakeFrame(decoder, frame, submitted, result);
+  }
+  result->seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  vvdec_accessUnit_free(access_unit);
+  vvdec_decoder_close(decoder);
+  return ok;
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  return sorted[static_cast<size_t>(p * (sorted.size() - 1) + 0.5)];
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <bitstream.266> [profile|all] [threads]\n", argv[0]);
+    return 1;
+  }
+  std::string which = argc > 2 ? argv[2] : "all";
+  int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+  std::vector<DecoderProfile> profiles;
+  if (which == "all") {
+    profiles = {DecoderProfile::kUltraLowLatency, DecoderProfile::kBalanced,
+                DecoderProfile::kThroughput};
+  } else {
+    DecoderProfile profile;
+    if (!ParseDecoderProfile(which, &profile)) {
+      fprintf(stderr, "Unknown profile: %s\n", which.c_str());
+      return 1;
+    }
+    profiles.push_back(profile);
+  }
+
+  std::vector<std::string> nal_units;
+  if (!LoadNalUnits(argv[1], &nal_units)) {
+    return 1;
+  }
+  printf("bitstream=%s nal_units=%zu\n", argv[1], nal_units.size());
+
+  bool ok = true;
+  for (DecoderProfile profile : profiles) {
+    Result result = {};
+    ok = Decode(nal_units, profile, threads, &result) && ok;
+    std::sort(result.latencies_ms.begin(), result.latencies_ms.end());
+    printf("%-18s frames=%llu  %7.1f fps  latency ms p50=%.1f p90=%.1f p99=%.1f max=%.1f\n",
+           DecoderProfileName(profile), static_cast<unsigned long long>(result.frames),
+           result.seconds > 0 ? result.frames / result.seconds : 0.0,
+           Percentile(result.latencies_ms, 0.5), Percentile(result.latencies_ms, 0.9),
+           Percentile(result.latencies_ms, 0.99),
+           result.latencies_ms.empty() ? 0.0 : result.latencies_ms.back());
+  }
+  return ok ? 0 : 1;
+}
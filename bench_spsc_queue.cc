@@ -0,0 +1,121 @@
+// Microbenchmark: SpscQueue vs a mutex + condition variable bounded queue
+//   make bench && ./build/bench_spsc_queue [items] [capacity]
+// Measures one-way throughput (producer streaming to a consumer) and the
+// round-trip latency of a ping-pong hand-off, the pattern the capture and
+// encode threads use per frame.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "tools/spsc_queue.h"
+
+// Reference queue: the mutex-plus-two-condvar pattern it replaces
+template <typename T>
+class LockedQueue {
+ public:
+  explicit LockedQueue(size_t capacity) : capacity_(capacity) {}
+
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_cv_.wait(lock, [this] { return items_.size() < capacity_; });
+    items_.push_back(item);
+    not_empty_cv_.notify_one();
+    return true;
+  }
+
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_cv_.wait(lock, [this] { return !items_.empty(); });
+    *item = items_.front();
+    items_.pop_front();
+    not_full_cv_.notify_one();
+    return true;
+  }
+
+ private:
+  size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_cv_;
+  std::condition_variable not_full_cv_;
+  std::deque<T> items_;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double ElapsedNs(Clock::time_point start) {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+// Stream items from one thread to another; returns false on a checksum mismatch
+template <typename Queue>
+static bool BenchThroughput(const char* name, uint64_t items, size_t capacity) {
+  Queue queue(capacity);
+  uint64_t sum = 0;
+
+  auto start = Clock::now();
+  std::thread consumer([&] {
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < items; i++) {
+      queue.Pop(&value);
+      sum += value;
+    }
+  });
+  for (uint64_t i = 0; i < items; i++) {
+    queue.Push(i);
+  }
+  consumer.join();
+  double ns = ElapsedNs(start);
+
+  bool ok = sum == items * (items - 1) / 2;
+  printf("%-12s throughput: %8.1f Mitems/s  %6.1f ns/item %s\n", name,
+         items * 1e3 / ns, ns / items, ok ? "" : "CHECKSUM MISMATCH");
+  return ok;
+}
+
+// Bounce one token between two threads; reports mean round-trip time
+template <typename Queue>
+static void BenchPingPong(const char* name, uint64_t rounds) {
+  Queue ping(1);
+  Queue pong(1);
+
+  std::thread echo([&] {
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < rounds; i++) {
+      ping.Pop(&value);
+      pong.Push(value);
+    }
+  });
+  auto start = Clock::now();
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < rounds; i++) {
+    ping.Push(i);
+    pong.Pop(&value);
+  }
+  double ns = ElapsedNs(start);
+  echo.join();
+
+  printf("%-12s ping-pong:  %8.0f ns/round trip\n", name, ns / rounds);
+}
+
+int main(int argc, char** argv) {
+  uint64_t items = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+  size_t capacity = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1024;
+  uint64_t rounds = items / 100 > 0 ? items / 100 : 1;
+
+  printf("items=%llu capacity=%zu ping-pong rounds=%llu\n",
+         static_cast<unsigned long long>(items), capacity,
+         static_cast<unsigned long long>(rounds));
+
+  bool ok = BenchThroughput<SpscQueue<uint64_t>>("SpscQueue", items, capacity);
+  ok = BenchThroughput<LockedQueue<uint64_t>>("LockedQueue", items, capacity) && ok;
+  BenchPingPong<SpscQueue<uint64_t>>("SpscQueue", rounds);
+  BenchPingPong<LockedQueue<uint64_t>>("LockedQueue", rounds);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+#include "access_unit_sender.h"
+
+#include <algorithm>
+
+#include "log_system/log_system.h"
+#include "transmission/message_sender.h"
+
+AccessUnitSender::AccessUnitSender()
+    : output_stream_(nullptr),
+      message_sender_(nullptr),
+      payload_size_(0),
+      running_(false),
+      current_(nullptr),
+      buffer_waits_(0),
+      buffer_wait_time_(0),
+      replacements_(0),
+      max_frame_size_(0) {}
+
+AccessUnitSender::~AccessUnitSender() {
+  Stop();
+}
+
+int AccessUnitSender::Start(int buffer_count, int payload_size,
+                            std::ofstream* output_stream,
+                            MessageSender* message_sender) {
+  if (running_) {
+    LOG(WARNING) << "[AccessUnitSender] Already started";
+    return 0;
+  }
+  if (buffer_count < 1 || payload_size < 1) {
+    LOG(ERROR) << "[AccessUnitSender] Invalid buffer count " << buffer_count
+               << " or payload size " << payload_size;
+    return -1;
+  }
+
+  output_stream_ = output_stream;
+  message_sender_ = message_sender;
+  payload_size_ = payload_size;
+  queue_ = std::make_unique<SpscQueue<Payload*>>(static_cast<size_t>(buffer_count));
+  free_ = std::make_unique<SpscQueue<Payload*>>(static_cast<size_t>(buffer_count));
+  for (int i = 0; i < buffer_count; i++) {
+    Payload* payload = AllocatePayload();
+    if (payload == nullptr) {
+      for (std::unique_ptr<Payload>& allocated : payloads_) {
+        vvenc_accessUnit_free_payload(&allocated->access_unit);
+      }
+      payloads_.clear();
+      return -1;
+    }
+    free_->Push(payload);
+  }
+  current_ = nullptr;
+  sent_.clear();
+  replaced_.clear();
+  stats_ = StageStats();
+  buffer_waits_ = 0;
+  buffer_wait_time_ = std::chrono::steady_clock::duration(0);
+  replacements_ = 0;
+  max_frame_size_ = 0;
+
+  running_ = true;
+  thread_.Start([this]() { Run(); });
+
+  LOG(INFO) << "[AccessUnitSender] Started with " << buffer_count << " access units of "
+            << payload_size << " bytes";
+  return 0;
+}
+
+AccessUnitSender::Payload* AccessUnitSender::AllocatePayload() {
+  auto payload = std::make_unique<Payload>();
+  vvenc_accessUnit_default(&payload->access_unit);
+  vvenc_accessUnit_alloc_payload(&payload->access_unit, payload_size_);
+  if (payload->access_unit.payload == nullptr) {
+    LOG(ERROR) << "[AccessUnitSender] Failed to allocate an access unit of "
+               << payload_size_ << " bytes";
+    return nullptr;
+  }
+  payload->frame_sequence = 0;
+  payloads_.push_back(std::move(payload));
+  return payloads_.back().get();
+}
+
+vvencAccessUnit* AccessUnitSender::NextAccessUnit() {
+  if (!running_) {
+    return nullptr;
+  }
+  if (current_ == nullptr) {
+    if (!free_->TryPop(&current_)) {
+      // Every access unit is queued or still being sent
+      auto wait_start = std::chrono::steady_clock::now();
+      free_->Pop(&current_);
+      buffer_wait_time_ += std::chrono::steady_clock::now() - wait_start;
+      buffer_waits_++;
+    }
+    current_->access_unit.payloadUsedSize = 0;
+  }
+  return &current_->access_unit;
+}
+
+bool AccessUnitSender::Send(uint32_t frame_sequence) {
+  if (!running_ || current_ == nullptr) {
+    return false;
+  }
+
+  Payload* payload = current_;
+  current_ = nullptr;
+  payload->frame_sequence = frame_sequence;
+  payload->queued_at = std::chrono::steady_clock::now();
+  max_frame_size_ =
+      std::max(max_frame_size_, static_cast<size_t>(payload->access_unit.payloadUsedSize));
+  return queue_->Push(payload);
+}
+
+void AccessUnitSender::Stop() {
+  if (!running_) {
+    return;
+  }
+  // Queued access units are still written and sent
+  queue_->Close();
+  thread_.Join();
+  running_ = false;
+  current_ = nullptr;
+
+  // An access unit the kernel still reads from is leaked rather than freed
+  // under it
+  size_t leaked = 0;
+  for (std::unique_ptr<Payload>& payload : payloads_) {
+    if (message_sender_ && message_sender_->IsBufferInFlight(payload->access_unit.payload)) {
+      leaked++;
+      continue;
+    }
+    vvenc_accessUnit_free_payload(&payload->access_unit);
+  }
+  if (leaked > 0) {
+    LOG(ERROR) << "[AccessUnitSender] Leaking " << leaked
+               << " access units still held by zerocopy sends";
+  }
+  payloads_.clear();
+  sent_.clear();
+  replaced_.clear();
+}
+
+void AccessUnitSender::Run() {
+  LOG(INFO) << "[AccessUnitSender] Send thread started";
+
+  Payload* payload = nullptr;
+  for (;;) {
+    // Hand the encoder back the access units the kernel is done with, and
+    // wait for them while it has none left and nothing is queued
+    while (queue_->IsEmpty() && free_->IsEmpty() && !sent_.empty()) {
+      ReturnSentPayloads(true);
+    }
+    ReturnSentPayloads(false);
+
+    auto wait_start = std::chrono::steady_clock::now();
+    if (!queue_->Pop(&payload)) {
+      break;
+    }
+    auto start = std::chrono::steady_clock::now();
+    stats_.RecordIdle(start - wait_start);
+    stats_.RecordItem(queue_->Size(), payload->queued_at, start);
+
+    WriteAndSend(*payload);
+    sent_.push_back(payload);
+    stats_.RecordBusy(std::chrono::steady_clock::now() - start);
+  }
+
+  // Give the kernel one release timeout per access unit; Stop leaks any it
+  // still holds
+  if (message_sender_) {
+    for (Payload* sent : sent_) {
+      message_sender_->WaitForBufferRelease(sent->access_unit.payload);
+    }
+  }
+  LOG(INFO) << "[AccessUnitSender] Send thread finished. Access units: "
+            << stats_.GetItems();
+}
+
+void AccessUnitSender::WriteAndSend(const Payload& payload) {
+  const vvencAccessUnit& access_unit = payload.access_unit;
+  if (output_stream_ && output_stream_->is_open()) {
+    output_stream_->write(reinterpret_cast<const char*>(access_unit.payload),
+                          access_unit.payloadUsedSize);
+    if (output_stream_->fail()) {
+      LOG(ERROR) << "[AccessUnitSender] write bitstream file failed (disk full?)";
+    }
+  }
+
+  if (message_sender_ && message_sender_->IsInitialized()) {
+    if (message_sender_->SendData(access_unit.payload, access_unit.payloadUsedSize,
+                                  payload.frame_sequence) != 0) {
+      LOG(ERROR) << "[AccessUnitSender] Failed to send frame " << payload.frame_sequence;
+    }
+  }
+
+  LOG(INFO) << "[AccessUnitSender] Sent frame " << payload.frame_sequence << " ("
+            << access_unit.payloadUsedSize << " bytes)";
+}
+
+void AccessUnitSender::ReturnSentPayloads(bool wait) {
+  if (sent_.empty() && replaced_.empty()) {
+    return;
+  }
+  if (message_sender_ == nullptr) {
+    for (Payload* payload : sent_) {
+      free_->Push(payload);
+    }
+    sent_.clear();
+    return;
+  }
+
+  if (wait && !sent_.empty()) {
+    Payload* oldest = sent_.front();
+    if (message_sender_->WaitForBufferRelease(oldest->access_unit.payload) != 0 &&
+        message_sender_->IsBufferInFlight(oldest->access_unit.payload)) {
+      Payload* replacement = AllocatePayload();
+      if (replacement != nullptr) {
+        LOG(WARNING) << "[AccessUnitSender] Frame " << oldest->frame_sequence
+                     << " still in flight after the release timeout, replacing its "
+                        "access unit";
+        sent_.pop_front();
+        replaced_.push_back(oldest);
+        free_->Push(replacement);
+        replacements_++;
+      }
+    }
+  } else {
+    message_sender_->ReapZeroCopyCompletions();
+  }
+  std::erase_if(sent_, [this](Payload* payload) {
+    if (message_sender_->IsBufferInFlight(payload->access_unit.payload)) {
+      return false;
+    }
+    free_->Push(payload);
+    return true;
+  });
+  FreeReleasedPayloads();
+}
+
+void AccessUnitSender::FreeReleasedPayloads() {
+  std::erase_if(replaced_, [this](Payload* payload) {
+    if (message_sender_->IsBufferInFlight(payload->access_unit.payload)) {
+      return false;
+    }
+    vvenc_accessUnit_free_payload(&payload->access_unit);
+    std::erase_if(payloads_, [payload](const std::unique_ptr<Payload>& allocated) {
+      return allocated.get() == payload;
+    });
+    return true;
+  });
+}
+
+void AccessUnitSender::PrintStats() const {
+  LOG(INFO) << "[AccessUnitSender] Send stage: " << stats_.ToString()
+            << " buffer_waits=" << buffer_waits_ << " buffer_wait_ms="
+            << std::chrono::duration_cast<std::chrono::milliseconds>(buffer_wait_time_)
+                   .count()
+            << " replacements=" << replacements_ << " max_frame_bytes=" << max_frame_size_;
+}
@@ -0,0 +1,117 @@
+#ifndef CODEC_ACCESS_UNIT_SENDER_H
+#define CODEC_ACCESS_UNIT_SENDER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "tools/spsc_queue.h"
+#include "tools/stage_stats.h"
+#include "tools/thread_manager.h"
+#include "vvenc/vvenc.h"
+
+class MessageSender;
+
+// AccessUnitSender writes encoded access units to the bitstream file and
+// sends them on a thread of its own, so the encoder can start on the next
+// frame while the previous one's packets go out.
+// It owns a small pool of vvenc access units that rotate through
+// vvenc_encode: the encoder thread encodes into the one NextAccessUnit
+// returns and hands it over with Send, without a copy. An access unit
+// comes back once the file write and send are done and, with MSG_ZEROCOPY
+// or io_uring, once the kernel has released it. vvenc drops an access unit
+// that does not fit, so each one is allocated for the worst case; its pages
+// are only committed as far as frames have been written into it.
+// NextAccessUnit and Send must be called from one thread (the encoder
+// thread). The output stream and message sender are used only by the send
+// thread until Stop.
+class AccessUnitSender {
+ public:
+  AccessUnitSender();
+  ~AccessUnitSender();
+
+  AccessUnitSender(const AccessUnitSender&) = delete;
+  AccessUnitSender& operator=(const AccessUnitSender&) = delete;
+
+  // Start the send thread with buffer_count access units of payload_size
+  // bytes. Either of output_stream and message_sender may be null
+  // Returns 0 on success, negative value on error
+  int Start(int buffer_count, int payload_size, std::ofstream* output_stream,
+            MessageSender* message_sender);
+
+  // Access unit for vvenc to encode the next frame into, waiting while every
+  // one is queued or in flight. The same one is returned until Send
+  // Returns nullptr if the sender is not running
+  vvencAccessUnit* NextAccessUnit();
+
+  // Queue the access unit from NextAccessUnit, which now holds an encoded
+  // frame, for writing and sending
+  // Returns false if the sender is not running or holds no access unit
+  bool Send(uint32_t frame_sequence);
+
+  // Write and send the queued access units, stop the thread and free the
+  // access units (leaking any the kernel still reads from)
+  void Stop();
+
+  // Log queue, wait and buffer statistics
+  void PrintStats() const;
+
+ private:
+  // Pooled access unit, owned by the encoder thread while free or being
+  // encoded into, and by the send thread while queued or in flight
+  struct Payload {
+    vvencAccessUnit access_unit;
+    uint32_t frame_sequence;
+    std::chrono::steady_clock::time_point queued_at;
+  };
+
+  // Allocate a pooled access unit
+  // Returns nullptr on allocation failure
+  Payload* AllocatePayload();
+
+  // Send thread main loop
+  void Run();
+
+  // Write one access unit to the file and the network
+  void WriteAndSend(const Payload& payload);
+
+  // Return sent access units the kernel no longer reads from. With wait
+  // set, wait for the oldest one first; if it is still in flight after the
+  // release timeout it is set aside and replaced by a new access unit, so
+  // the encoder never writes into a buffer the kernel may still read
+  void ReturnSentPayloads(bool wait);
+
+  // Free set-aside access units the kernel has released
+  void FreeReleasedPayloads();
+
+  std::ofstream* output_stream_;
+  MessageSender* message_sender_;
+  int payload_size_;
+  // Every allocated access unit, added to by the send thread while running
+  std::vector<std::unique_ptr<Payload>> payloads_;
+  std::unique_ptr<SpscQueue<Payload*>> queue_;  // encoder -> send
+  std::unique_ptr<SpscQueue<Payload*>> free_;   // send -> encoder
+  Thread thread_;
+  bool running_;
+
+  // Encoder thread state: access unit being encoded into
+  Payload* current_;
+
+  // Send thread state: access units sent but possibly still read by the
+  // kernel, and those replaced after a release timeout
+  std::deque<Payload*> sent_;
+  std::deque<Payload*> replaced_;
+
+  // Statistics, read once stopped
+  StageStats stats_;
+  uint64_t buffer_waits_;
+  std::chrono::steady_clock::duration buffer_wait_time_;
+  uint64_t replacements_;
+  size_t max_frame_size_;
+};
+
+#endif  // CODEC_ACCESS_UNIT_SENDER_H
@@ -1,6 +1,7 @@
 #include "decoder.h"
 
 #include <arpa/inet.h>
+#include <algorithm>
 #include <cstring>
 #include <ctime>
 #include <fstream>
@@ -11,6 +12,13 @@
 #include "tools/yuv_file_io.h"
 #include "transmission/feedback_manage.h"
 
+// Initial payload of pooled access units (grown by the frame assembler)
+static constexpr size_t kInitialAccessUnitSize = 64 * FrameAssembler::kDefaultPayloadSize;
+
+// Complete frames left in the assembler before the receive thread waits for
+// an access unit, well below the slot count so their slots are not reused
+static constexpr size_t kMaxPendingFrames = FrameAssembler::kDefaultSlotCount / 2;
+
 // Format current time as yyyy-mm-dd-hh-mm-ss-mmm
 static std::string FormatTimestamp() {
   auto now = std::chrono::system_clock::now();
@@ -18,7 +26,9 @@ static std::string FormatTimestamp() {
   auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
       now.time_since_epoch()) % 1000;
 
-  std::tm* tm_info = std::localtime(&time_t);
+  // localtime_r: receiver shards format timestamps concurrently
+  std::tm tm_buf;
+  std::tm* tm_info = localtime_r(&time_t, &tm_buf);
   if (!tm_info) {
     return "0000-00-00-00-00-00-000";
   }
@@ -39,10 +49,16 @@ static std::string FormatTimestamp() {
 Decoder::Decoder()
     : decoder_(nullptr),
       initialized_(false),
-      last_completed_frame_(0),
-      feedback_sender_(nullptr) {
-  vvdec_accessUnit_default(&access_unit_);
-}
+      profile_(DecoderProfile::kThroughput),
+      profile_threads_(0),
+      use_buffer_pool_(true),
+      decode_queue_depth_(kDefaultDecodeQueueDepth),
+      write_flush_interval_(FrameWriter::kDefaultFlushIntervalMs),
+      dropped_frames_(0),
+      use_io_uring_(false),
+      output_(nullptr),
+      next_timestamp_(0),
+      feedback_sender_(nullptr) {}
 
 Decoder::~Decoder() {
   Cleanup();
@@ -59,10 +75,9 @@ int Decoder::Initialize(int width, int height, const std::string& output_file) {
   // Store output file path
   output_file_ = output_file;
 
-  // Open output file if specified
-  if (!output_file_.empty()) {
-    output_stream_.open(output_file_, std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!output_stream_.is_open()) {
+  // Open output file if specified (the decode pipeline's writer opens its own)
+  if (!output_file_.empty() && decode_queue_depth_ == 0) {
+    if (OpenOutput() != 0) {
       LOG(ERROR) << "[Decoder] Failed to open output file: " << output_file_;
       return -1;
     }
@@ -73,36 +88,35 @@ int Decoder::Initialize(int width, int height, const std::string& output_file) {
   vvdec_params_default(&params_);
   params_.logLevel = VVDEC_NOTICE;
   params_.enable_realtime = true;
-
-  // Open decoder
-  decoder_ = vvdec_decoder_open(&params_);
+  ApplyDecoderProfile(profile_, profile_threads_, &params_);
+  LOG(INFO) << "[Decoder] Profile: " << DecoderProfileName(profile_)
+            << " threads=" << params_.threads << " parseDelay=" << params_.parseDelay
+            << " simd=" << static_cast<int>(params_.simd);
+
+  // Open decoder, with pooled picture buffers if enabled
+  if (use_buffer_pool_) {
+    buffer_pool_ = std::make_unique<PictureBufferPool>();
+    params_.opaque = buffer_pool_.get();
+    decoder_ = vvdec_decoder_open_with_allocator(&params_, &PictureBufferPool::CreateBuffer,
+                                                 &PictureBufferPool::UnrefBuffer);
+  } else {
+    decoder_ = vvdec_decoder_open(&params_);
+  }
   if (decoder_ == nullptr) {
     LOG(ERROR) << "[Decoder] Failed to open decoder";
-    if (output_stream_.is_open()) {
-      output_stream_.close();
-    }
+    CloseOutput();
     return -1;
   }
 
-  // Allocate access unit for decoding
-  vvdec_accessUnit_alloc_payload(&access_unit_, MAX_CODED_PICTURE_SIZE);
-  if (access_unit_.payload == nullptr) {
-    LOG(ERROR) << "[Decoder] Failed to allocate access unit payload";
-    vvdec_decoder_close(decoder_);
-    decoder_ = nullptr;
-    if (output_stream_.is_open()) {
-      output_stream_.close();
-    }
+  initialized_ = true;
+  next_timestamp_ = 0;
+  frame_assembler_.Reset();
+
+  if (decode_queue_depth_ > 0 && StartPipeline() != 0) {
+    LOG(ERROR) << "[Decoder] Failed to start decode pipeline";
+    Cleanup();
     return -1;
   }
-  access_unit_.cts = 0;
-  access_unit_.ctsValid = true;
-  access_unit_.dts = 0;
-  access_unit_.dtsValid = true;
-
-  initialized_ = true;
-  last_completed_frame_ = 0;
-  frame_assemblies_.clear();
 
   LOG(VERBOSE) << "[Decoder] Decoder initialized successfully";
 
@@ -115,11 +129,29 @@ int Decoder::HandlePacketMessage(const uint8_t* packet_data, size_t packet_size)
     return -1;
   }
 
+  if (!pending_frames_.empty()) {
+    QueuePendingFrames(kMaxPendingFrames);
+  }
   // Process the packet (handles assembly and decoding when complete)
   ProcessPacket(packet_data, packet_size);
   return 0;
 }
 
+int Decoder::HandlePacketBatch(const ReceivedPacket* packets, size_t count) {
+  if (!decoder_ || !initialized_) {
+    LOG(ERROR) << "[Decoder] Decoder not initialized";
+    return -1;
+  }
+
+  if (!pending_frames_.empty()) {
+    QueuePendingFrames(kMaxPendingFrames);
+  }
+  for (size_t i = 0; i < count; i++) {
+    ProcessPacket(packets[i].data, packets[i].size);
+  }
+  return 0;
+}
+
 void Decoder::ProcessPacket(const uint8_t* packet_data, size_t packet_size) {
   if (packet_size < sizeof(PacketHeader)) {
     LOG(WARNING) << "[Decoder] Packet too small, ignoring";
@@ -141,72 +173,185 @@ void Decoder::ProcessPacket(const uint8_t* packet_data, size_t packet_size) {
     return;
   }
 
-  // Get or create frame assembly
-  auto& frame_assembly = frame_assemblies_[frame_sequence];
-  if (frame_assembly.packets.empty()) {
-    // New frame
-    frame_assembly.total_packets = total_packets;
-    frame_assembly.received_packets = 0;
-    frame_assembly.complete = false;
-    frame_assembly.packets.resize(total_packets);
-    LOG(INFO) << "[Decoder] Starting frame " << frame_sequence
-              << " expecting " << total_packets << " packets";
+  // Store the payload in its frame's slot
+  FrameAssembler::Frame frame;
+  FrameAssembler::AddResult result = frame_assembler_.AddPacket(
+      frame_sequence, packet_index, total_packets,
+      packet_data + sizeof(PacketHeader), payload_size, &frame);
+  if (result != FrameAssembler::AddResult::kAdded &&
+      result != FrameAssembler::AddResult::kCompleted) {
+    return;
   }
 
-  // Validate packet index
-  if (packet_index >= total_packets) {
-    LOG(WARNING) << "[Decoder] Invalid packet index " << packet_index
-                 << " for frame " << frame_sequence;
-    return;
+  LOG(INFO) << "[Decoder] Received packet " << packet_index << "/"
+            << (total_packets - 1) << " for frame " << frame_sequence
+            << " (" << frame_assembler_.GetReceivedPackets(frame_sequence) << "/"
+            << total_packets << " complete)";
+
+  // Send feedback for received packet
+  SendFeedback(frame_sequence, packet_index);
+
+  if (result == FrameAssembler::AddResult::kCompleted) {
+    if (decode_queue_) {
+      QueueFrame(frame_sequence);
+    } else {
+      // Write frame to file and decode
+      DecodeAndWriteFrame(frame_sequence, frame.access_unit);
+    }
   }
+}
 
-  // Store packet payload
-  if (frame_assembly.packets[packet_index].empty()) {
-    // New packet for this frame
-    const uint8_t* payload = packet_data + sizeof(PacketHeader);
-    frame_assembly.packets[packet_index].assign(payload, payload + payload_size);
-    frame_assembly.received_packets++;
+void Decoder::QueueFrame(uint32_t frame_sequence) {
+  pending_frames_.push_back(frame_sequence);
+  QueuePendingFrames(kMaxPendingFrames);
+}
 
-    LOG(INFO) << "[Decoder] Received packet " << packet_index << "/"
-              << (total_packets - 1) << " for frame " << frame_sequence
-              << " (" << frame_assembly.received_packets << "/" << total_packets
-              << " complete)";
+void Decoder::QueuePendingFrames(size_t max_pending) {
+  while (!pending_frames_.empty()) {
+    // An empty pool means every access unit is queued or being decoded
+    vvdecAccessUnit* access_unit = nullptr;
+    if (!free_access_units_->TryPop(&access_unit)) {
+      if (pending_frames_.size() <= max_pending) {
+        return;
+      }
+      LOG(WARNING) << "[Decoder] Decode queue full, waiting to queue frame "
+                   << pending_frames_.front();
+      free_access_units_->Pop(&access_unit);
+    }
+    uint32_t frame_sequence = pending_frames_.front();
+    pending_frames_.pop_front();
+    if (!frame_assembler_.TakeAccessUnit(frame_sequence, access_unit)) {
+      // A newer frame took over the slot while it waited
+      dropped_frames_++;
+      LOG(ERROR) << "[Decoder] Decode queue full, dropped frame " << frame_sequence
+                 << "; frames referencing it will not decode until the next keyframe";
+      free_access_units_->TryPush(access_unit);
+      continue;
+    }
+    // The queue holds the whole pool, so this never fails
+    decode_queue_->TryPush({frame_sequence, access_unit, std::chrono::steady_clock::now()});
+  }
+}
+
+int Decoder::StartPipeline() {
+  // One access unit more than the queue depth, for the one being decoded
+  size_t pool_size = static_cast<size_t>(decode_queue_depth_) + 1;
+  access_units_.resize(pool_size);
+  free_access_units_ = std::make_unique<SpscQueue<vvdecAccessUnit*>>(pool_size);
+  decode_queue_ = std::make_unique<SpscQueue<QueuedAccessUnit>>(pool_size);
+  for (vvdecAccessUnit& access_unit : access_units_) {
+    vvdec_accessUnit_default(&access_unit);
+    vvdec_accessUnit_alloc_payload(&access_unit, static_cast<int>(kInitialAccessUnitSize));
+    free_access_units_->TryPush(&access_unit);
+  }
+  decode_stats_ = StageStats();
+  pending_frames_.clear();
+  dropped_frames_ = 0;
+
+  if (!output_file_.empty()) {
+    writer_ = std::make_unique<FrameWriter>();
+    writer_->SetFlushInterval(write_flush_interval_);
+    if (writer_->Start(output_file_) != 0) {
+      LOG(ERROR) << "[Decoder] Failed to open output file: " << output_file_;
+      return -1;
+    }
+  }
+  decode_thread_.Start([this]() { RunDecode(); });
+
+  LOG(INFO) << "[Decoder] Decode pipeline started, decode queue depth: "
+            << decode_queue_depth_ << (writer_ ? ", write thread" : "");
+  return 0;
+}
 
-    // Send feedback for received packet
-    SendFeedback(frame_sequence, packet_index);
+void Decoder::StopPipeline() {
+  if (!decode_queue_) {
+    return;
+  }
+  // Frames already complete are still decoded and written
+  QueuePendingFrames(0);
+  decode_queue_->Close();
+  decode_thread_.Join();
+  decode_stats_.RecordDropped(dropped_frames_);
+  if (writer_) {
+    if (writer_->Stop() != 0) {
+      LOG(ERROR) << "[Decoder] Failed to write output file: " << output_file_;
+    }
+    // The decode thread is gone, so release the last frames here
+    ReleaseWrittenFrames();
+  }
+
+  for (vvdecAccessUnit& access_unit : access_units_) {
+    if (access_unit.payload) {
+      vvdec_accessUnit_free_payload(&access_unit);
+    }
   }
+  access_units_.clear();
+  decode_queue_.reset();
+  free_access_units_.reset();
+}
 
-  // Check if frame is complete
-  if (frame_assembly.received_packets == total_packets && !frame_assembly.complete) {
-    frame_assembly.complete = true;
+void Decoder::RunDecode() {
+  LOG(INFO) << "[Decoder] Decode thread started";
 
-    // Reassemble frame
-    std::vector<uint8_t> frame_data;
-    for (const auto& packet : frame_assembly.packets) {
-      frame_data.insert(frame_data.end(), packet.begin(), packet.end());
+  QueuedAccessUnit item;
+  for (;;) {
+    auto wait_start = std::chrono::steady_clock::now();
+    if (!decode_queue_->Pop(&item)) {
+      break;
     }
+    auto start = std::chrono::steady_clock::now();
+    decode_stats_.RecordIdle(start - wait_start);
+    decode_stats_.RecordItem(decode_queue_->Size(), item.queued_at, start);
 
-    // Write frame to file and decode
-    DecodeAndWriteFrame(frame_sequence, frame_data);
-
-    // Clean up old frame assemblies (keep only recent ones)
-    if (frame_sequence > last_completed_frame_) {
-      last_completed_frame_ = frame_sequence;
-      // Remove frames older than 1 frames
-      auto it = frame_assemblies_.begin();
-      while (it != frame_assemblies_.end()) {
-        if (it->first < frame_sequence - 10) {
-          it = frame_assemblies_.erase(it);
-        } else {
-          ++it;
-        }
-      }
+    ReleaseWrittenFrames();
+
+    LOG(INFO) << "[Decoder] Decoding frame " << item.frame_sequence
+              << " size=" << item.access_unit->payloadUsedSize << " bytes";
+    vvdecFrame* decoded_frame = DecodeFrame(item.access_unit);
+    free_access_units_->TryPush(item.access_unit);
+    decode_stats_.RecordBusy(std::chrono::steady_clock::now() - start);
+
+    if (decoded_frame == nullptr) {
+      LOG(ERROR) << "[Decoder] Failed to decode frame " << item.frame_sequence;
+      continue;
+    }
+    // Waits while the write thread is behind
+    if (!writer_ || !writer_->Write(item.frame_sequence, decoded_frame)) {
+      ReleaseFrame(decoded_frame);
+    }
+  }
+
+  LOG(INFO) << "[Decoder] Decode thread finished. Frames: " << decode_stats_.GetItems();
+}
+
+void Decoder::ReleaseWrittenFrames() {
+  vvdecFrame* frame = nullptr;
+  while (writer_ && writer_->TakeWrittenFrame(&frame)) {
+    ReleaseFrame(frame);
+  }
+}
+
+void Decoder::PrintStats() const {
+  if (decode_queue_depth_ > 0) {
+    LOG(INFO) << "[Decoder] Decode stage: " << decode_stats_.ToString();
+    if (writer_) {
+      writer_->PrintStats();
     }
   }
+  if (buffer_pool_) {
+    buffer_pool_->PrintStats();
+  }
 }
 
-void Decoder::DecodeAndWriteFrame(uint32_t frame_sequence,
-                         const std::vector<uint8_t>& frame_data) {
+size_t Decoder::ExpireIncompleteFrames(std::chrono::milliseconds max_age) {
+  // Runs on the receive thread even when no packets arrive
+  if (!pending_frames_.empty()) {
+    QueuePendingFrames(kMaxPendingFrames);
+  }
+  return frame_assembler_.ExpireIncompleteFrames(max_age);
+}
+
+void Decoder::DecodeAndWriteFrame(uint32_t frame_sequence, vvdecAccessUnit* access_unit) {
   // Write encoded bitstream to file if output stream is set
   // if (output_stream_.is_open()) {
   //   output_stream_.write(reinterpret_cast<const char*>(frame_data.data()),
@@ -224,56 +369,63 @@ void Decoder::DecodeAndWriteFrame(uint32_t frame_sequence,
 
   // Decode the complete frame (frame_data is already a complete NAL unit/access unit)
   LOG(INFO) << "[Decoder] Decoding frame " << frame_sequence
-            << " size=" << frame_data.size() << " bytes";
+            << " size=" << access_unit->payloadUsedSize << " bytes";
 
-  vvdecFrame* decoded_frame = DecodeFrame(frame_data.data(), frame_data.size());
+  vvdecFrame* decoded_frame = DecodeFrame(access_unit);
 
   if (decoded_frame != nullptr) {
-    if (output_stream_.is_open()) {
-      if ( 0 != writeYUVToFile(&output_stream_, decoded_frame, true, false)) {
-        LOG(ERROR) << "[Decoder] Failed to write decoded frame to file " << frame_sequence;
-      } else {
-        // Flush the stream to ensure data is written to disk immediately
-        output_stream_.flush();
-        if (output_stream_.fail()) {
-          LOG(ERROR) << "[Decoder] Failed to flush output stream for frame " << frame_sequence;
-        }
-        LOG(VERBOSE) << "[Decoder] Successfully wrote decoded frame to file " << frame_sequence << " packet size: " << frame_data.size() << " bytes";
-      }
-    }
+    WriteFrame(frame_sequence, decoded_frame);
 
     // Release the frame after processing
-    // ReleaseFrame(decoded_frame);
+    ReleaseFrame(decoded_frame);
   } else {
     LOG(ERROR) << "[Decoder] Failed to decode frame " << frame_sequence;
   }
 }
 
-vvdecFrame* Decoder::DecodeFrame(const uint8_t* frame_data, size_t frame_size) {
+void Decoder::WriteFrame(uint32_t frame_sequence, vvdecFrame* frame) {
+  if (output_ == nullptr) {
+    return;
+  }
+  if ( 0 != writeYUVToFile(output_, frame, true, false)) {
+    LOG(ERROR) << "[Decoder] Failed to write decoded frame to file " << frame_sequence;
+    return;
+  }
+  // Flush the stream to ensure data is written to disk immediately
+  // (with io_uring the write is queued and completes asynchronously)
+  output_->flush();
+  if (output_->fail()) {
+    LOG(ERROR) << "[Decoder] Failed to flush output stream for frame " << frame_sequence;
+  }
+  LOG(VERBOSE) << "[Decoder] Successfully wrote decoded frame to file " << frame_sequence;
+}
+
+vvdecFrame* Decoder::DecodeFrame(vvdecAccessUnit* access_unit) {
   if (!decoder_ || !initialized_) {
     LOG(ERROR) << "[Decoder] Decoder not initialized";
     return nullptr;
   }
 
-  if (!frame_data || frame_size == 0) {
+  if (!access_unit || access_unit->payloadUsedSize <= 0) {
     LOG(ERROR) << "[Decoder] Invalid frame data";
     return nullptr;
   }
 
-  // Copy frame data to access unit (frame_data is already a complete NAL unit)
-  std::memcpy(access_unit_.payload, frame_data, frame_size);
-  access_unit_.payloadUsedSize = frame_size;
+  // The payload was assembled in place and is already a complete access unit
+  access_unit->cts = next_timestamp_;
+  access_unit->ctsValid = true;
+  access_unit->dts = next_timestamp_;
+  access_unit->dtsValid = true;
 
-  vvdecNalType eNalType = vvdec_get_nal_unit_type( &access_unit_ );
+  vvdecNalType eNalType = vvdec_get_nal_unit_type( access_unit );
   bool bIsSlice  = vvdec_is_nal_unit_slice( eNalType );
 
   // Decode
   vvdecFrame* frame = nullptr;
-  int ret = vvdec_decode(decoder_, &access_unit_, &frame);
+  int ret = vvdec_decode(decoder_, access_unit, &frame);
 
   if (bIsSlice) {
-    access_unit_.cts++;
-    access_unit_.dts++;
+    next_timestamp_++;
   }
 
   // Check result
@@ -310,29 +462,107 @@ void Decoder::Cleanup() {
 
   LOG(INFO) << "[Decoder] Cleaning up decoder";
 
+  // The pipeline threads use the decoder and the output
+  StopPipeline();
+
   if (decoder_) {
     vvdec_decoder_close(decoder_);
     decoder_ = nullptr;
   }
 
-  // Free access unit
-  if (access_unit_.payload) {
-    vvdec_accessUnit_free_payload(&access_unit_);
-    access_unit_.payload = nullptr;
+  CloseOutput();
+
+  frame_assembler_.Reset();
+  initialized_ = false;
+}
+
+void Decoder::SetFeedbackSender(MessageSender* feedback_sender) {
+  feedback_sender_ = feedback_sender;
+}
+
+void Decoder::SetDecodeQueueDepth(int depth) {
+  if (initialized_) {
+    LOG(WARNING) << "[Decoder] Decode queue depth must be set before Initialize";
+    return;
   }
+  decode_queue_depth_ = std::max(0, depth);
+}
 
+void Decoder::SetWriteFlushInterval(std::chrono::milliseconds interval) {
+  if (initialized_) {
+    LOG(WARNING) << "[Decoder] Write flush interval must be set before Initialize";
+    return;
+  }
+  write_flush_interval_ = interval;
+}
+
+void Decoder::SetBufferPoolEnabled(bool enabled) {
+  if (initialized_) {
+    LOG(WARNING) << "[Decoder] Buffer pool must be set before Initialize";
+    return;
+  }
+  use_buffer_pool_ = enabled;
+}
+
+void Decoder::SetProfile(DecoderProfile profile, int threads) {
+  if (initialized_) {
+    LOG(WARNING) << "[Decoder] Profile must be set before Initialize";
+    return;
+  }
+  profile_ = profile;
+  profile_threads_ = threads;
+}
+
+void Decoder::SetIoUringEnabled(bool enabled) {
+  if (initialized_) {
+    LOG(WARNING) << "[Decoder] io_uring must be set before Initialize";
+    return;
+  }
+  use_io_uring_ = enabled;
+}
+
+int Decoder::OpenOutput() {
+#ifdef HAVE_IO_URING
+  if (use_io_uring_ && IoUringEngine::IsSupported()) {
+    uring_output_buf_ = std::make_unique<IoUringWriteBuffer>();
+    if (uring_output_buf_->Open(output_file_) == 0) {
+      uring_output_stream_.rdbuf(uring_output_buf_.get());
+      uring_output_stream_.clear();
+      output_ = &uring_output_stream_;
+      return 0;
+    }
+    uring_output_buf_.reset();
+    LOG(WARNING) << "[Decoder] io_uring unavailable, using blocking writes";
+  }
+#else
+  if (use_io_uring_) {
+    LOG(WARNING) << "[Decoder] io_uring not available on this platform";
+  }
+#endif
+  output_stream_.open(output_file_, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!output_stream_.is_open()) {
+    return -1;
+  }
+  output_ = &output_stream_;
+  return 0;
+}
+
+void Decoder::CloseOutput() {
+#ifdef HAVE_IO_URING
+  if (uring_output_buf_) {
+    if (uring_output_buf_->Close() != 0) {
+      LOG(ERROR) << "[Decoder] Failed to write output file: " << output_file_;
+    }
+    uring_output_stream_.rdbuf(nullptr);
+    uring_output_buf_.reset();
+  }
+#endif
   if (output_stream_.is_open()) {
     // Flush before closing to ensure all data is written to disk
     output_stream_.flush();
     output_stream_.close();
   }
-
-  frame_assemblies_.clear();
-  initialized_ = false;
-}
-
-void Decoder::SetFeedbackSender(MessageSender* feedback_sender) {
-  feedback_sender_ = feedback_sender;
+  output_ = nullptr;
 }
 
 void Decoder::SendFeedback(uint32_t frame_sequence, uint16_t packet_index) {
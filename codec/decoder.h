@@ -1,24 +1,57 @@
 #ifndef CODEC_DECODER_H
 #define CODEC_DECODER_H
 
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <fstream>
-#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "codec/decoder_profile.h"
+#include "codec/frame_assembler.h"
+#include "codec/frame_writer.h"
+#include "codec/picture_buffer_pool.h"
 #include "transmission/message_handler.h"
 #include "transmission/message_sender.h"
 #include "transmission/feedback_manage.h"
 #include "vvdec/vvdec.h"
 #include "log_system/log_system.h"
 #include "transmission/packet_header.h"
-#include <chrono>
-
-#define MAX_CODED_PICTURE_SIZE 800000
-
+#include "tools/io_uring_file.h"
+#include "tools/spsc_queue.h"
+#include "tools/stage_stats.h"
+#include "tools/thread_manager.h"
+
+// Decoder receives packets on the network thread and reassembles them
+// there; everything slower runs on threads of its own, so the socket keeps
+// being drained while a frame decodes or is written:
+//
+//   receive thread --access units--> decode thread --frames--> write thread
+//
+// Complete access units are moved out of the assembler (swapped against an
+// empty one from a pool, no copy) into a bounded queue. When the decoder
+// falls behind and the pool is empty, a complete frame stays in its
+// assembler slot and is queued once an access unit comes back (later
+// frames queue behind it, so decode order is kept); the receive thread only
+// waits for one when a few frames are pending, before their slots could be
+// reused. Losing a complete frame would corrupt every frame predicted from
+// it. Decoded frames go on to a FrameWriter,
+// which batches them into large writes on the write thread and hands them
+// back to be unreferenced on the decode thread; a slow disk backs up into
+// the decode queue, not into the socket. Each stage keeps StageStats for
+// its input queue (see PrintStats).
+// With a decode queue depth of 0 everything runs on the receive thread and
+// every frame is written and flushed through an ostream.
+// Either way a decoded frame is unreferenced as soon as it is written;
+// with the buffer pool enabled its planes then go back to the
+// PictureBufferPool once vvdec no longer needs them for reference.
 class Decoder : public MessageHandler {
  public:
+  // Default number of access units queued for the decode thread
+  static constexpr int kDefaultDecodeQueueDepth = 8;
+
   Decoder();
   ~Decoder();
 
@@ -31,51 +64,144 @@ class Decoder : public MessageHandler {
   int HandlePacketMessage(const uint8_t* packet_data,
                          size_t packet_size) override;
 
+  // HandlePacketBatch implementation from MessageHandler
+  // Assembles every packet of a receive batch (e.g. split GRO segments)
+  int HandlePacketBatch(const ReceivedPacket* packets, size_t count) override;
+
+  // Drop incomplete frames whose first packet arrived more than max_age ago
+  // (lost packets would otherwise hold their assembly slot until it is reused)
+  // Returns the number of frames dropped
+  size_t ExpireIncompleteFrames(std::chrono::milliseconds max_age);
+
   // Cleanup resources
   void Cleanup();
 
   // Set feedback sender for sending feedback messages
   void SetFeedbackSender(MessageSender* feedback_sender);
 
+  // Write the output file through io_uring (falls back to std::ofstream if
+  // unavailable); only used with a decode queue depth of 0. Must be called
+  // before Initialize
+  void SetIoUringEnabled(bool enabled);
+
+  // Set the number of access units queued between the receive and decode
+  // threads (0 decodes on the receive thread). Must be called before
+  // Initialize
+  void SetDecodeQueueDepth(int depth);
+
+  // Set how long decoded frames may wait to be written in one batch (see
+  // FrameWriter). Must be called before Initialize
+  void SetWriteFlushInterval(std::chrono::milliseconds interval);
+
+  // Allocate decoded pictures from a PictureBufferPool instead of vvdec's
+  // own allocator. Must be called before Initialize
+  void SetBufferPoolEnabled(bool enabled);
+
+  // Select the vvdec latency profile; threads > 0 overrides its thread
+  // count. Must be called before Initialize
+  void SetProfile(DecoderProfile profile, int threads = 0);
+
+  // Log per-stage queue and timing statistics
+  void PrintStats() const;
+
  private:
   // Send feedback message for a received packet
   void SendFeedback(uint32_t frame_sequence, uint16_t packet_index);
 
  private:
-  // Frame assembly state
-  struct FrameAssembly {
-    std::vector<std::vector<uint8_t>> packets;  // Packets for this frame
-    uint16_t total_packets;                      // Expected total packets
-    uint32_t received_packets;                  // Number of packets received
-    bool complete;                              // Frame is complete
-  };
-
   // Process a received packet (internal method)
   void ProcessPacket(const uint8_t* packet_data, size_t packet_size);
 
-  // Decode a complete frame from assembled data
+  // Decode a complete frame assembled in access_unit (timestamps are set here)
   // Returns decoded frame pointer (caller must call ReleaseFrame when done)
-  vvdecFrame* DecodeFrame(const uint8_t* frame_data, size_t frame_size);
+  vvdecFrame* DecodeFrame(vvdecAccessUnit* access_unit);
 
   // Release a decoded frame
   void ReleaseFrame(vvdecFrame* frame);
 
+  // Open output_file_ for writing, through io_uring if enabled
+  // Returns 0 on success, negative value on error
+  int OpenOutput();
+
+  // Flush and close the output file
+  void CloseOutput();
+
   // Write complete frame to file (if output file is set)
-  void DecodeAndWriteFrame(uint32_t frame_sequence, const std::vector<uint8_t>& frame_data);
+  void DecodeAndWriteFrame(uint32_t frame_sequence, vvdecAccessUnit* access_unit);
+
+  // Write a decoded frame to the output (if output file is set)
+  void WriteFrame(uint32_t frame_sequence, vvdecFrame* frame);
+
+  // Hand a complete frame to the decode thread, after any frames still
+  // pending
+  void QueueFrame(uint32_t frame_sequence);
+
+  // Queue pending frames while free access units are left, then wait for
+  // access units while more than max_pending frames are pending
+  void QueuePendingFrames(size_t max_pending);
+
+  // Start the decode and write threads with their queues and the access
+  // unit pool
+  // Returns 0 on success, negative value on error
+  int StartPipeline();
+
+  // Drain the queues, join the threads and free the access unit pool
+  void StopPipeline();
+
+  // Decode thread: decode queued access units and pass frames on
+  void RunDecode();
+
+  // Unreference the frames the writer is done with (decode thread)
+  void ReleaseWrittenFrames();
+
+  // Access unit queued for the decode thread
+  struct QueuedAccessUnit {
+    uint32_t frame_sequence;
+    vvdecAccessUnit* access_unit;
+    std::chrono::steady_clock::time_point queued_at;
+  };
 
   vvdecDecoder* decoder_;
   vvdecParams params_;
   bool initialized_;
-
-  // Frame assembly map: frame_sequence -> FrameAssembly
-  std::map<uint32_t, FrameAssembly> frame_assemblies_;
-  uint32_t last_completed_frame_;
+  DecoderProfile profile_;
+  int profile_threads_;
+
+  // Picture buffers handed to vvdec (kept after Cleanup for PrintStats)
+  bool use_buffer_pool_;
+  std::unique_ptr<PictureBufferPool> buffer_pool_;
+
+  // Reassembles packets into complete frames; its slots' access units are
+  // passed to vvdec_decode directly (or swapped into the decode queue)
+  FrameAssembler frame_assembler_;
+
+  // Decode pipeline, see the class comment
+  int decode_queue_depth_;
+  std::vector<vvdecAccessUnit> access_units_;  // Pool, owns the payloads
+  std::unique_ptr<SpscQueue<vvdecAccessUnit*>> free_access_units_;  // decode -> receive
+  std::unique_ptr<SpscQueue<QueuedAccessUnit>> decode_queue_;       // receive -> decode
+  std::unique_ptr<FrameWriter> writer_;  // Write thread, if output file is set
+  std::chrono::milliseconds write_flush_interval_;
+  Thread decode_thread_;
+  StageStats decode_stats_;
+  // Receive thread state: complete frames, oldest first, left in their
+  // assembler slots until a free access unit takes them
+  std::deque<uint32_t> pending_frames_;
+  uint64_t dropped_frames_;  // Pending frames whose slot a newer frame took
 
   // Output file for writing encoded frames
   std::string output_file_;
   std::ofstream output_stream_;
-
-  vvdecAccessUnit access_unit_;
+  bool use_io_uring_;
+#ifdef HAVE_IO_URING
+  std::unique_ptr<IoUringWriteBuffer> uring_output_buf_;
+#endif
+  std::ostream uring_output_stream_{nullptr};
+  // Stream decoded frames are written to (nullptr if no output file)
+  std::ostream* output_;
+
+  // Timestamp of the next slice access unit (cts and dts)
+  uint64_t next_timestamp_;
 
   // Feedback sender for sending feedback messages
   MessageSender* feedback_sender_;
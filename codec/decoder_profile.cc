@@ -0,0 +1,55 @@
+#include "decoder_profile.h"
+
+#include <algorithm>
+#include <thread>
+
+// Frames the balanced profile parses ahead of the one being output
+static constexpr int kBalancedParseDelay = 2;
+
+bool ParseDecoderProfile(const std::string& name, DecoderProfile* profile) {
+  if (name == "ultra-low-latency") {
+    *profile = DecoderProfile::kUltraLowLatency;
+  } else if (name == "balanced") {
+    *profile = DecoderProfile::kBalanced;
+  } else if (name == "throughput") {
+    *profile = DecoderProfile::kThroughput;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* DecoderProfileName(DecoderProfile profile) {
+  switch (profile) {
+    case DecoderProfile::kUltraLowLatency:
+      return "ultra-low-latency";
+    case DecoderProfile::kBalanced:
+      return "balanced";
+    case DecoderProfile::kThroughput:
+      return "throughput";
+  }
+  return "unknown";
+}
+
+void ApplyDecoderProfile(DecoderProfile profile, int threads, vvdecParams* params) {
+  int cpus = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  // Vector code helps latency and throughput alike, so every profile uses
+  // the widest instruction set available
+  params->simd = VVDEC_SIMD_DEFAULT;
+
+  switch (profile) {
+    case DecoderProfile::kUltraLowLatency:
+      params->threads = threads > 0 ? threads : cpus;
+      params->parseDelay = 0;
+      break;
+    case DecoderProfile::kBalanced:
+      params->threads = threads > 0 ? threads : cpus;
+      params->parseDelay = std::min(kBalancedParseDelay, params->threads);
+      break;
+    case DecoderProfile::kThroughput:
+      // -1 lets vvdec pick: all cores, and parse-ahead by the thread count
+      params->threads = threads > 0 ? threads : -1;
+      params->parseDelay = -1;
+      break;
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef CODEC_DECODER_PROFILE_H
+#define CODEC_DECODER_PROFILE_H
+
+#include <string>
+
+#include "vvdec/vvdec.h"
+
+// Receiver latency profile: how vvdec trades per-frame latency for
+// throughput. Measure them on the target machine with bench_decoder
+enum class DecoderProfile {
+  kUltraLowLatency,  // No parse-ahead: a frame is out one decode time after
+                     // its access unit, parallelism only within a picture
+  kBalanced,         // Parse a couple of frames ahead to keep threads busy
+  kThroughput,       // vvdec defaults: all cores, parse-ahead per thread
+};
+
+// Parse a profile name ("ultra-low-latency", "balanced", "throughput")
+// Returns true on success, false if the name is unknown
+bool ParseDecoderProfile(const std::string& name, DecoderProfile* profile);
+
+// Get the name of a profile
+const char* DecoderProfileName(DecoderProfile profile);
+
+// Set vvdec threads, parseDelay and simd for profile. threads > 0
+// overrides the profile's thread count (whose default is the number of
+// online CPUs)
+void ApplyDecoderProfile(DecoderProfile profile, int threads, vvdecParams* params);
+
+#endif  // CODEC_DECODER_PROFILE_H
@@ -1,5 +1,6 @@
 #include "encoder.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstddef>
 #include <cstring>
@@ -13,13 +14,16 @@ Encoder::Encoder()
     : frame_capture_(nullptr),
       message_sender_(nullptr),
       encoder_(nullptr),
-      yuv_input_buffer_(),
       access_unit_(),
+      access_unit_size_(0),
       output_stream_(nullptr),
       initialized_(false),
       sequence_number_(0),
-      max_frames_(-1) {
-  vvenc_YUVBuffer_default(&yuv_input_buffer_);
+      max_frames_(-1),
+      input_bit_depth_(kDefaultInputBitDepth),
+      chroma_format_(kDefaultInputChromaFormat),
+      send_queue_depth_(kDefaultSendQueueDepth),
+      pipeline_running_(false) {
   vvenc_accessUnit_default(&access_unit_);
 }
 
@@ -64,21 +68,38 @@ int Encoder::Initialize(int width, int height, int fps, int framesToBeEncoded) {
   vvenc_get_config(encoder_, &params_);
   LOG(VERBOSE) << "[Encoder] Adapted config";
 
-  // Allocate and initialize the YUV Buffer
-  vvenc_YUVBuffer_alloc_buffer(&yuv_input_buffer_, params_.m_internChromaFormat,
-                                params_.m_SourceWidth, params_.m_SourceHeight);
-
-  // Allocate and initialize the access unit storage for output packets
+  // Access unit storage for output packets. vvenc drops an access unit
+  // that does not fit, so it is sized for the worst case; with a send queue
+  // the send thread's pooled access units are used instead
   const int auSizeScale =
       params_.m_internChromaFormat <= VVENC_CHROMA_420 ? 2 : 3;
-  vvenc_accessUnit_alloc_payload(
-      &access_unit_,
-      auSizeScale * params_.m_SourceWidth * params_.m_SourceHeight + 1024);
+  access_unit_size_ =
+      auSizeScale * params_.m_SourceWidth * params_.m_SourceHeight + 1024;
+  if (send_queue_depth_ == 0) {
+    vvenc_accessUnit_alloc_payload(&access_unit_, access_unit_size_);
+  }
 
   initialized_ = true;
   return 0;
 }
 
+void Encoder::SetInputFormat(int bit_depth, vvencChromaFormat chroma_format) {
+  if (initialized_) {
+    LOG(WARNING) << "[Encoder] Input format must be set before Initialize";
+    return;
+  }
+  input_bit_depth_ = bit_depth;
+  chroma_format_ = chroma_format;
+}
+
+void Encoder::SetSendQueueDepth(int depth) {
+  if (initialized_) {
+    LOG(WARNING) << "[Encoder] Send queue depth must be set before Initialize";
+    return;
+  }
+  send_queue_depth_ = std::max(0, depth);
+}
+
 void Encoder::SetOutputStream(std::ofstream* output_stream) {
   output_stream_ = output_stream;
 }
@@ -102,20 +123,41 @@ int Encoder::EncodeFrame(vvencYUVBuffer* input_buffer, bool& bEncodeDone) {
     return -1;
   }
 
-  // Set frame metadata
+  // Set frame metadata, keeping a capture timestamp set by the source
   input_buffer->sequenceNumber = sequence_number_;
-  input_buffer->cts = sequence_number_;
-  input_buffer->ctsValid = true;
+  if (!input_buffer->ctsValid) {
+    input_buffer->cts = sequence_number_;
+    input_buffer->ctsValid = true;
+  }
+
+  vvencAccessUnit* access_unit = &access_unit_;
+  if (pipeline_running_) {
+    // The send thread only hands out access units it is done with
+    access_unit = sender_->NextAccessUnit();
+    if (!access_unit) {
+      LOG(ERROR) << "[Encoder] No access unit from the send thread";
+      return -1;
+    }
+  } else {
+    if (!access_unit_.payload) {
+      vvenc_accessUnit_alloc_payload(&access_unit_, access_unit_size_);
+    }
+    // vvenc writes the next AU into access_unit_.payload, which MSG_ZEROCOPY
+    // sends of the previous frame may still be reading
+    if (message_sender_ && ReleaseAccessUnit() != 0) {
+      return -1;
+    }
+  }
 
   auto start_time = std::chrono::high_resolution_clock::now();
-  int iRet = vvenc_encode(encoder_, input_buffer, &access_unit_, &bEncodeDone);
+  int iRet = vvenc_encode(encoder_, input_buffer, access_unit, &bEncodeDone);
   if (0 != iRet) {
     LOG(ERROR) << "[Encoder] Encoding failed: " << iRet << " "
                << vvenc_get_last_error(encoder_);
     return iRet;
   }
-  if (access_unit_.payloadUsedSize > 0) {
-    WriteEncodedData(start_time);
+  if (access_unit->payloadUsedSize > 0) {
+    WriteEncodedData(*access_unit, start_time);
   }
 
   sequence_number_++;
@@ -123,6 +165,45 @@ int Encoder::EncodeFrame(vvencYUVBuffer* input_buffer, bool& bEncodeDone) {
   return 0;
 }
 
+int Encoder::ReleaseAccessUnit() {
+  FreeReleasedAccessUnits();
+  if (message_sender_->WaitForBufferRelease(access_unit_.payload) == 0 ||
+      !message_sender_->IsBufferInFlight(access_unit_.payload)) {
+    return 0;
+  }
+
+  vvencAccessUnit replacement;
+  vvenc_accessUnit_default(&replacement);
+  vvenc_accessUnit_alloc_payload(&replacement, access_unit_size_);
+  if (!replacement.payload) {
+    LOG(ERROR) << "[Encoder] Previous access unit still in flight and failed to allocate "
+               << access_unit_size_ << " bytes for a new one, dropping frame "
+               << sequence_number_;
+    return -1;
+  }
+  LOG(WARNING) << "[Encoder] Previous access unit still in flight after the release "
+                  "timeout, replacing it";
+  replaced_access_units_.push_back(access_unit_);
+  access_unit_ = replacement;
+  return 0;
+}
+
+void Encoder::FreeReleasedAccessUnits() {
+  if (replaced_access_units_.empty()) {
+    return;
+  }
+  if (message_sender_) {
+    message_sender_->ReapZeroCopyCompletions();
+  }
+  std::erase_if(replaced_access_units_, [this](vvencAccessUnit& access_unit) {
+    if (message_sender_ && message_sender_->IsBufferInFlight(access_unit.payload)) {
+      return false;
+    }
+    vvenc_accessUnit_free_payload(&access_unit);
+    return true;
+  });
+}
+
 void Encoder::Run() {
   if (!initialized_) {
     LOG(ERROR) << "[Encoder] Encoder not initialized";
@@ -138,8 +219,9 @@ void Encoder::Run() {
 
   sequence_number_ = 0;
 
-  // Signal ready for first frame
-  SignalReadyForNextFrame();
+  if (send_queue_depth_ > 0 && StartPipeline() != 0) {
+    return;
+  }
 
   while (!stop_requested_) {
     // Wait for frame from frame capture
@@ -154,17 +236,22 @@ void Encoder::Run() {
       break;
     }
 
-    // Copy frame data to encoder's buffer
-    CopyFrameBuffer(frame_buffer);
-
-    // Encode the frame
+    // Encode straight from the capture buffer; vvenc copies the picture
+    // into its own storage, so the buffer can be refilled right after
     bool bEncodeDone = false;
     LOG(INFO) << "[Encoder] Encoding frame: " << sequence_number_;
+    const uint64_t capture_tick = frame_buffer->cts;
     int iRet = EncodeFrame(frame_buffer, bEncodeDone);
+    frame_capture_->ReleaseFrame(frame_buffer);
     if (0 != iRet) {
       LOG(ERROR) << "[Encoder] Encoding failed: " << iRet;
       break;
     }
+    const CaptureClock& clock = frame_capture_->GetClock();
+    if (clock.IsPaced()) {
+      LOG(INFO) << "[Encoder] Capture to encoded latency (ms): "
+                << (CaptureClock::NowNs() - clock.DeadlineNs(capture_tick)) / 1e6;
+    }
 
     // Check if encoding is complete or max frames reached
     bool should_stop = false;
@@ -186,11 +273,11 @@ void Encoder::Run() {
       }
       break;
     }
-
-    // Signal ready for next frame (this allows frame capture to read next frame)
-    SignalReadyForNextFrame();
   }
 
+  // Write and send what is still queued
+  StopPipeline();
+
   LOG(INFO) << "[Encoder] Encoder thread finished. Total frames encoded: "
             << sequence_number_;
   
@@ -198,14 +285,6 @@ void Encoder::Run() {
   PrintSummary();
 }
 
-void Encoder::SignalReadyForNextFrame() {
-  // Check if frame_capture_ is still valid before accessing
-  FrameCapture* fc = frame_capture_;
-  if (fc) {
-    fc->SignalEncoderReady();
-  }
-}
-
 void Encoder::Stop() {
   stop_requested_ = true;
 }
@@ -214,46 +293,29 @@ bool Encoder::IsStopped() const {
   return stop_requested_.load();
 }
 
-void Encoder::CopyFrameBuffer(const vvencYUVBuffer* source) {
-  if (!source) {
-    return;
-  }
-
-  // Copy metadata
-  yuv_input_buffer_.sequenceNumber = source->sequenceNumber;
-  yuv_input_buffer_.cts = source->cts;
-  yuv_input_buffer_.ctsValid = source->ctsValid;
-
-  // Copy plane data (Y, U, V)
-  for (int i = 0; i < 3; i++) {
-    const vvencYUVPlane& src_plane = source->planes[i];
-    vvencYUVPlane& dst_plane = yuv_input_buffer_.planes[i];
-
-    if (src_plane.ptr && dst_plane.ptr) {
-      // Calculate size to copy
-      size_t plane_size = src_plane.height * src_plane.stride * sizeof(int16_t);
-      std::memcpy(dst_plane.ptr, src_plane.ptr, plane_size);
-    }
-  }
-}
-
 void Encoder::WriteEncodedData(
+    const vvencAccessUnit& access_unit,
     const std::chrono::high_resolution_clock::time_point& start_time) {
-  if (access_unit_.payloadUsedSize > 0) {
-    // Write to file if output stream is set
-    if (output_stream_ && output_stream_->is_open()) {
-      output_stream_->write((const char*)access_unit_.payload,
-                            access_unit_.payloadUsedSize);
+  if (access_unit.payloadUsedSize > 0) {
+    if (pipeline_running_) {
+      // The send thread takes over the access unit and writes and sends it
+      if (!sender_->Send(static_cast<uint32_t>(sequence_number_))) {
+        LOG(ERROR) << "[Encoder] Failed to queue encoded data for sending";
+      }
+    } else if (output_stream_ && output_stream_->is_open()) {
+      // Write to file if output stream is set
+      output_stream_->write((const char*)access_unit.payload,
+                            access_unit.payloadUsedSize);
       if (output_stream_->fail()) {
         LOG(ERROR) << "[Encoder] write bitstream file failed (disk full?)";
       }
     }
 
     // Send via network if message sender is set
-    if (message_sender_ && message_sender_->IsInitialized()) {
+    if (!pipeline_running_ && message_sender_ && message_sender_->IsInitialized()) {
       int ret = message_sender_->SendData(
-          access_unit_.payload,
-          access_unit_.payloadUsedSize,
+          access_unit.payload,
+          access_unit.payloadUsedSize,
           static_cast<uint32_t>(sequence_number_));
       if (ret != 0) {
         LOG(ERROR) << "[Encoder] Failed to send encoded data via network";
@@ -261,8 +323,8 @@ void Encoder::WriteEncodedData(
     }
 
     LOG(INFO) << "[Encoder] Write encoded AU of size: "
-              << access_unit_.payloadUsedSize << " bytes"
-              << " kbps: " << access_unit_.payloadUsedSize * 240 / 1000;
+              << access_unit.payloadUsedSize << " bytes"
+              << " kbps: " << access_unit.payloadUsedSize * 240 / 1000;
     auto end_time = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> encode_duration =
         end_time - start_time;
@@ -278,6 +340,25 @@ void Encoder::Cleanup() {
     return;  // Already cleaned up
   }
 
+  StopPipeline();
+
+  // Give the last frame's zerocopy sends one release timeout; access units
+  // the kernel still reads from are leaked rather than freed under it
+  if (access_unit_.payload) {
+    if (message_sender_) {
+      message_sender_->WaitForBufferRelease(access_unit_.payload);
+    }
+    replaced_access_units_.push_back(access_unit_);
+    vvenc_accessUnit_default(&access_unit_);
+    access_unit_.payload = nullptr;
+  }
+  FreeReleasedAccessUnits();
+  if (!replaced_access_units_.empty()) {
+    LOG(ERROR) << "[Encoder] Leaking " << replaced_access_units_.size()
+               << " access units still held by zerocopy sends";
+    replaced_access_units_.clear();
+  }
+
   // Clear references first to avoid dangling pointers
   frame_capture_ = nullptr;
   message_sender_ = nullptr;
@@ -287,20 +368,6 @@ void Encoder::Cleanup() {
     encoder_ = nullptr;
   }
 
-  // Only free buffers if they were allocated
-  if (yuv_input_buffer_.planes[0].ptr) {
-    vvenc_YUVBuffer_free_buffer(&yuv_input_buffer_);
-    // Clear pointers after freeing to avoid double-free
-    yuv_input_buffer_.planes[0].ptr = nullptr;
-    yuv_input_buffer_.planes[1].ptr = nullptr;
-    yuv_input_buffer_.planes[2].ptr = nullptr;
-  }
-  
-  if (access_unit_.payload) {
-    vvenc_accessUnit_free_payload(&access_unit_);
-    access_unit_.payload = nullptr;
-  }
-
   initialized_ = false;
 }
 
@@ -325,13 +392,42 @@ void Encoder::PrintSummary() const {
   std::cerr.flush();
 }
 
+void Encoder::PrintStats() const {
+  if (sender_) {
+    sender_->PrintStats();
+  }
+}
+
+int Encoder::StartPipeline() {
+  if (!sender_) {
+    sender_ = std::make_unique<AccessUnitSender>();
+  }
+  // Two more access units than queued, for the one being encoded into and
+  // the one being sent
+  if (sender_->Start(send_queue_depth_ + 2, access_unit_size_, output_stream_,
+                     message_sender_) != 0) {
+    LOG(ERROR) << "[Encoder] Failed to start send thread";
+    return -1;
+  }
+  pipeline_running_ = true;
+  return 0;
+}
+
+void Encoder::StopPipeline() {
+  if (!pipeline_running_) {
+    return;
+  }
+  sender_->Stop();
+  pipeline_running_ = false;
+}
+
 void Encoder::InitializeEncoderParams(vvenc_config* params, int width,
                                        int height, int fps,
                                        int framesToBeEncoded) { /* vvenc real time configurations */
   // Initialize with default parameters
   vvenc_init_default(params, width, height, fps, VVENC_RC_OFF, VVENC_AUTO_QP,
                         vvencPresetMode::VVENC_FAST);
-  params->m_internChromaFormat = kFileChromaFormat;
+  params->m_internChromaFormat = chroma_format_;
   params->m_framesToBeEncoded = framesToBeEncoded;
 
   params->m_IntraPeriod = -1;
@@ -377,8 +473,11 @@ void Encoder::InitializeEncoderParams(vvenc_config* params, int width,
   params->m_FirstPassMode = 4;
   params->m_AccessUnitDelimiter = 1;
   params->m_lumaReshapeEnable = 0;
-  params->m_internalBitDepth[0] = 8;
-  params->m_internalBitDepth[1] = 8;
+  // Code at the input bit depth, FrameCapture hands over unscaled samples
+  params->m_inputBitDepth[0] = input_bit_depth_;
+  params->m_inputBitDepth[1] = input_bit_depth_;
+  params->m_internalBitDepth[0] = input_bit_depth_;
+  params->m_internalBitDepth[1] = input_bit_depth_;
 
   // Disable LookAhead for real-time encoding (it causes frame buffering)
   params->m_LookAhead = 0;
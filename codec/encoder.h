@@ -5,9 +5,12 @@
 #include <condition_variable>
 #include <fstream>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
+#include "codec/access_unit_sender.h"
 #include "tools/yuv_file_io.h"
 #include "vvenc/vvenc.h"
 #include "vvenc/vvencCfg.h"
@@ -16,14 +19,32 @@
 class FrameCapture;
 class MessageSender;
 
+// Encoder encodes captured frames with vvenc. Run writes and sends the
+// encoded access units on a separate thread (see AccessUnitSender), so
+// encoding frame N+1 overlaps sending frame N; with a send queue depth of
+// 0, or when EncodeFrame is called outside Run, they are written and sent
+// before EncodeFrame returns.
 class Encoder {
  public:
+  // Default number of encoded access units between encoder and sender
+  static constexpr int kDefaultSendQueueDepth = 4;
+
   Encoder();
   ~Encoder();
 
   // Initialize encoder with configuration
   int Initialize(int width, int height, int fps, int framesToBeEncoded = -1);
 
+  // Set the sample format of the frames passed to the encoder, which is
+  // also the coded format (bit_depth 8 or 10). Must be called before
+  // Initialize
+  void SetInputFormat(int bit_depth, vvencChromaFormat chroma_format);
+
+  // Set how many encoded access units may be queued for the send thread
+  // (0 writes and sends on the encoder thread). Must be called before
+  // Initialize
+  void SetSendQueueDepth(int depth);
+
   // Set output stream for encoded data
   void SetOutputStream(std::ofstream* output_stream);
 
@@ -34,16 +55,14 @@ class Encoder {
   void SetFrameCapture(FrameCapture* frame_capture);
 
   // Run encoder in thread-safe mode (to be called in a separate thread)
-  // Works with FrameCapture for synchronized frame-by-frame encoding
+  // Encodes FrameCapture's buffers in place and returns them to its pool
   void Run();
 
-  // Encode a single frame (for frame-by-frame encoding)
+  // Encode a single frame (for frame-by-frame encoding). The buffer's cts
+  // is kept if ctsValid is set, otherwise the frame number is used
   // Returns 0 on success, negative value on error
   int EncodeFrame(vvencYUVBuffer* input_buffer, bool& bEncodeDone);
 
-  // Signal that encoder is ready for next frame
-  void SignalReadyForNextFrame();
-
   // Stop the encoder
   void Stop();
 
@@ -56,29 +75,55 @@ class Encoder {
   // Get encoder statistics
   void PrintSummary() const;
 
+  // Log send stage statistics
+  void PrintStats() const;
+
  private:
   // Initialize encoder parameters
   void InitializeEncoderParams(vvenc_config* params, int width, int height,
                                int fps, int framesToBeEncoded);
 
-  // Copy frame buffer data from source to encoder's buffer
-  void CopyFrameBuffer(const vvencYUVBuffer* source);
-
-  // Write encoded access unit to output stream
+  // Write an encoded access unit to the output stream and network, or hand
+  // it to the send thread
   void WriteEncodedData(
+      const vvencAccessUnit& access_unit,
       const std::chrono::high_resolution_clock::time_point& start_time);
 
+  // Start and stop the send thread used by Run
+  int StartPipeline();
+  void StopPipeline();
+
+  // Wait one release timeout for zerocopy sends of the previous frame to
+  // let go of access_unit_; if they still hold it, set it aside and encode
+  // into a new access unit instead
+  // Returns 0 on success, negative value if no access unit could be allocated
+  int ReleaseAccessUnit();
+
+  // Free set-aside access units the kernel has released
+  void FreeReleasedAccessUnits();
+
   FrameCapture* frame_capture_;
   MessageSender* message_sender_;
 
   vvencEncoder* encoder_;
   vvenc_config params_;
-  vvencYUVBuffer yuv_input_buffer_;
-  vvencAccessUnit access_unit_;
+  vvencAccessUnit access_unit_;  // Allocated once frames are encoded outside the send thread
+  int access_unit_size_;         // Worst-case access unit payload
+  // Former access_unit_ payloads still read by zerocopy sends
+  std::vector<vvencAccessUnit> replaced_access_units_;
   std::ofstream* output_stream_;
   bool initialized_;
   int64_t sequence_number_;
   int64_t max_frames_;
+  int input_bit_depth_;
+  vvencChromaFormat chroma_format_;
+  int send_queue_depth_;
+
+  // Send thread, while Run is encoding with a non-zero send queue depth.
+  // vvenc then encodes into the send thread's pooled access units instead
+  // of access_unit_
+  std::unique_ptr<AccessUnitSender> sender_;
+  bool pipeline_running_;
 
   // Thread synchronization
   std::atomic<bool> stop_requested_;
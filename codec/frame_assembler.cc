@@ -0,0 +1,269 @@
+#include "frame_assembler.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <utility>
+
+#include "log_system/log_system.h"
+
+// Packets per slot preallocated up front (about 90 KB of payload)
+static constexpr size_t kInitialPacketsPerSlot = 64;
+
+// Arena and frame sizes are bounded by kMaxFrameSize, so they fit the int
+// sizes of vvdec access units
+static_assert(FrameAssembler::kMaxFrameSize <= INT_MAX);
+
+// Serial number comparison, so sequence wraparound keeps the ring ordered
+static bool IsOlder(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+
+FrameAssembler::FrameAssembler(size_t slot_count, size_t payload_size_hint)
+    : slots_(std::max<size_t>(slot_count, 1)),
+      payload_size_hint_(payload_size_hint) {
+  for (Slot& slot : slots_) {
+    slot.in_use = false;
+    slot.complete = false;
+    slot.frame_sequence = 0;
+    slot.total_packets = 0;
+    slot.received_packets = 0;
+    slot.stride = 0;
+    slot.last_payload_size = 0;
+    slot.received.resize((kInitialPacketsPerSlot + 63) / 64);
+    vvdec_accessUnit_default(&slot.access_unit);
+    vvdec_accessUnit_alloc_payload(
+        &slot.access_unit,
+        static_cast<int>(std::min(kInitialPacketsPerSlot * payload_size_hint_, kMaxFrameSize)));
+  }
+}
+
+FrameAssembler::~FrameAssembler() {
+  for (Slot& slot : slots_) {
+    if (slot.access_unit.payload) {
+      vvdec_accessUnit_free_payload(&slot.access_unit);
+    }
+  }
+}
+
+FrameAssembler::AddResult FrameAssembler::AddPacket(
+    uint32_t frame_sequence, uint16_t packet_index, uint16_t total_packets,
+    const uint8_t* payload, size_t payload_size, Frame* frame) {
+  if (packet_index >= total_packets) {
+    LOG(WARNING) << "[FrameAssembler] Invalid packet index " << packet_index
+                 << " for frame " << frame_sequence;
+    return AddResult::kInvalid;
+  }
+  bool last_packet = packet_index == total_packets - 1;
+  if (payload_size > kMaxPayloadSize || (!last_packet && payload_size == 0)) {
+    LOG(WARNING) << "[FrameAssembler] Unexpected payload size " << payload_size
+                 << " for frame " << frame_sequence << " packet " << packet_index;
+    return AddResult::kInvalid;
+  }
+  // No payload of a frame exceeds its stride, so this bounds the frame
+  // before its slot is taken over or anything is allocated for it
+  if (static_cast<size_t>(total_packets) * payload_size > kMaxFrameSize) {
+    LOG(WARNING) << "[FrameAssembler] Frame " << frame_sequence << " of " << total_packets
+                 << " packets of " << payload_size << " bytes exceeds the maximum frame size "
+                 << kMaxFrameSize;
+    return AddResult::kInvalid;
+  }
+
+  Slot& slot = slots_[frame_sequence % slots_.size()];
+  if (!slot.in_use || IsOlder(slot.frame_sequence, frame_sequence)) {
+    StartFrame(&slot, frame_sequence, total_packets);
+  } else if (slot.frame_sequence != frame_sequence) {
+    return AddResult::kStale;
+  } else if (slot.total_packets != total_packets) {
+    LOG(WARNING) << "[FrameAssembler] Packet count mismatch for frame "
+                 << frame_sequence << " packet " << packet_index;
+    return AddResult::kInvalid;
+  }
+
+  uint64_t& word = slot.received[packet_index / 64];
+  uint64_t bit = uint64_t(1) << (packet_index % 64);
+  if (slot.complete || (word & bit) != 0) {
+    return AddResult::kDuplicate;
+  }
+
+  if (!last_packet) {
+    // Every packet but the last fills the frame's stride exactly
+    if (slot.stride == 0) {
+      if (!SetStride(&slot, payload_size)) {
+        return AddResult::kInvalid;
+      }
+    } else if (payload_size != slot.stride) {
+      LOG(WARNING) << "[FrameAssembler] Payload size " << payload_size << " of frame "
+                   << frame_sequence << " packet " << packet_index
+                   << " differs from the frame's stride " << slot.stride;
+      return AddResult::kInvalid;
+    }
+    std::memcpy(slot.access_unit.payload + packet_index * slot.stride, payload,
+                payload_size);
+  } else if (total_packets == 1) {
+    if (!ReserveArena(&slot, payload_size)) {
+      return AddResult::kInvalid;
+    }
+    std::memcpy(slot.access_unit.payload, payload, payload_size);
+    slot.last_payload_size = payload_size;
+  } else if (slot.stride != 0) {
+    if (payload_size > slot.stride) {
+      LOG(WARNING) << "[FrameAssembler] Last packet of frame " << frame_sequence
+                   << " exceeds the frame's stride " << slot.stride;
+      return AddResult::kInvalid;
+    }
+    std::memcpy(slot.access_unit.payload + packet_index * slot.stride, payload,
+                payload_size);
+    slot.last_payload_size = payload_size;
+  } else {
+    // Its offset depends on the stride, placed by SetStride
+    slot.held_last.assign(payload, payload + payload_size);
+    slot.last_payload_size = payload_size;
+  }
+  word |= bit;
+  slot.received_packets++;
+
+  if (slot.received_packets < slot.total_packets) {
+    return AddResult::kAdded;
+  }
+  // At most total_packets * stride, which SetStride bounded by kMaxFrameSize
+  size_t frame_size = (slot.total_packets - 1) * slot.stride + slot.last_payload_size;
+  if (frame_size > kMaxFrameSize) {
+    LOG(WARNING) << "[FrameAssembler] Frame " << frame_sequence << " of " << frame_size
+                 << " bytes exceeds the maximum frame size " << kMaxFrameSize;
+    slot.in_use = false;
+    return AddResult::kInvalid;
+  }
+  slot.complete = true;
+  slot.access_unit.payloadUsedSize = static_cast<int>(frame_size);
+  frame->frame_sequence = frame_sequence;
+  frame->access_unit = &slot.access_unit;
+  return AddResult::kCompleted;
+}
+
+void FrameAssembler::StartFrame(Slot* slot, uint32_t frame_sequence,
+                                uint16_t total_packets) {
+  if (slot->in_use && !slot->complete) {
+    LOG(WARNING) << "[FrameAssembler] Evicting incomplete frame " << slot->frame_sequence
+                 << " (" << slot->received_packets << "/" << slot->total_packets
+                 << " packets) for frame " << frame_sequence;
+  }
+
+  size_t words = (static_cast<size_t>(total_packets) + 63) / 64;
+  if (slot->received.size() < words) {
+    slot->received.resize(words);
+  }
+  std::fill(slot->received.begin(), slot->received.begin() + words, 0);
+  slot->access_unit.payloadUsedSize = 0;
+
+  slot->in_use = true;
+  slot->complete = false;
+  slot->frame_sequence = frame_sequence;
+  slot->total_packets = total_packets;
+  slot->received_packets = 0;
+  slot->stride = 0;
+  slot->last_payload_size = 0;
+  slot->held_last.clear();
+  slot->start_time = std::chrono::steady_clock::now();
+  LOG(INFO) << "[FrameAssembler] Starting frame " << frame_sequence
+            << " expecting " << total_packets << " packets";
+}
+
+bool FrameAssembler::ReserveArena(Slot* slot, size_t size) {
+  // Nothing of the previous frame is kept, so grow by reallocating; double
+  // the size so a run of growing I-frames reallocates only a few times
+  size_t capacity = static_cast<size_t>(slot->access_unit.payloadSize);
+  if (capacity >= size) {
+    return true;
+  }
+  if (size > kMaxFrameSize) {
+    LOG(WARNING) << "[FrameAssembler] Frame " << slot->frame_sequence << " of " << size
+                 << " bytes exceeds the maximum frame size " << kMaxFrameSize;
+    slot->in_use = false;
+    return false;
+  }
+  LOG(VERBOSE) << "[FrameAssembler] Growing slot payload to hold frame "
+               << slot->frame_sequence << " (" << size << " bytes)";
+  vvdec_accessUnit_free_payload(&slot->access_unit);
+  vvdec_accessUnit_alloc_payload(
+      &slot->access_unit, static_cast<int>(std::min(std::max(size, capacity * 2), kMaxFrameSize)));
+  if (slot->access_unit.payload == nullptr) {
+    LOG(ERROR) << "[FrameAssembler] Failed to allocate " << size << " bytes for frame "
+               << slot->frame_sequence;
+    slot->access_unit.payloadSize = 0;
+    slot->in_use = false;
+    return false;
+  }
+  return true;
+}
+
+bool FrameAssembler::SetStride(Slot* slot, size_t stride) {
+  uint16_t last_index = slot->total_packets - 1;
+  bool last_held = (slot->received[last_index / 64] >> (last_index % 64)) & 1;
+  if (last_held && slot->last_payload_size > stride) {
+    LOG(WARNING) << "[FrameAssembler] Last packet of frame " << slot->frame_sequence
+                 << " exceeds the frame's stride " << stride << ", dropping the frame";
+    slot->in_use = false;
+    return false;
+  }
+  size_t frame_size = static_cast<size_t>(slot->total_packets) * stride;
+  if (frame_size > kMaxFrameSize) {
+    LOG(WARNING) << "[FrameAssembler] Frame " << slot->frame_sequence << " of "
+                 << slot->total_packets << " packets of " << stride
+                 << " bytes exceeds the maximum frame size " << kMaxFrameSize;
+    slot->in_use = false;
+    return false;
+  }
+  if (!ReserveArena(slot, frame_size)) {
+    return false;
+  }
+  slot->stride = stride;
+  if (last_held) {
+    std::memcpy(slot->access_unit.payload + last_index * stride, slot->held_last.data(),
+                slot->held_last.size());
+    slot->held_last.clear();
+  }
+  return true;
+}
+
+bool FrameAssembler::TakeAccessUnit(uint32_t frame_sequence,
+                                    vvdecAccessUnit* access_unit) {
+  Slot& slot = slots_[frame_sequence % slots_.size()];
+  if (!slot.in_use || !slot.complete || slot.frame_sequence != frame_sequence) {
+    return false;
+  }
+  // The slot stays complete, so late duplicates are still recognized
+  std::swap(slot.access_unit, *access_unit);
+  slot.access_unit.payloadUsedSize = 0;
+  return true;
+}
+
+uint32_t FrameAssembler::GetReceivedPackets(uint32_t frame_sequence) const {
+  const Slot& slot = slots_[frame_sequence % slots_.size()];
+  if (!slot.in_use || slot.frame_sequence != frame_sequence) {
+    return 0;
+  }
+  return slot.received_packets;
+}
+
+size_t FrameAssembler::ExpireIncompleteFrames(std::chrono::milliseconds max_age) {
+  auto now = std::chrono::steady_clock::now();
+  size_t expired = 0;
+  for (Slot& slot : slots_) {
+    if (slot.in_use && !slot.complete && now - slot.start_time > max_age) {
+      LOG(WARNING) << "[FrameAssembler] Dropping incomplete frame " << slot.frame_sequence
+                   << " (" << slot.received_packets << "/" << slot.total_packets
+                   << " packets)";
+      slot.in_use = false;
+      expired++;
+    }
+  }
+  return expired;
+}
+
+void FrameAssembler::Reset() {
+  for (Slot& slot : slots_) {
+    slot.in_use = false;
+    slot.complete = false;
+  }
+}
@@ -0,0 +1,120 @@
+#ifndef CODEC_FRAME_ASSEMBLER_H
+#define CODEC_FRAME_ASSEMBLER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "transmission/packet_header.h"
+#include "vvdec/vvdec.h"
+
+// FrameAssembler reassembles packetized frames in a fixed ring of slots
+// indexed by frame_sequence % slot_count. Every slot owns a vvdec access
+// unit whose payload is the slot's arena. All packets of a frame but the
+// last carry the same payload size (the stride), which is taken from the
+// first such packet to arrive, so any sender packet size works. Packet i
+// is copied straight to offset i * stride, and a complete frame is an
+// access unit ready for vvdec_decode. A last packet that arrives before
+// the stride is known is held until it is. A bitmap tracks received
+// packets. Payloads only grow (for a frame larger than any before), so the
+// steady-state path does not allocate. Frames are limited to kMaxFrameSize,
+// so a forged header cannot force a huge allocation.
+// A new frame takes over its slot from whatever older frame occupied it,
+// which makes eviction O(1). Not thread safe.
+class FrameAssembler {
+ public:
+  // Default slot count (frames that can be assembled concurrently)
+  static constexpr size_t kDefaultSlotCount = 16;
+  // Payload per packet of the sender's default 1400 byte packets, used to
+  // size arenas up front
+  static constexpr size_t kDefaultPayloadSize = 1400 - sizeof(PacketHeader);
+  // Largest payload a UDP datagram can carry after the header
+  static constexpr size_t kMaxPayloadSize = 65507 - sizeof(PacketHeader);
+  // Largest frame (total_packets * stride) accepted; well above the
+  // encoder's worst case access unit for 4K
+  static constexpr size_t kMaxFrameSize = 64 << 20;
+
+  // Outcome of AddPacket
+  enum class AddResult {
+    kInvalid,    // Malformed packet (bad index, payload or frame size)
+    kStale,      // Frame is older than the one occupying its slot
+    kDuplicate,  // Packet was already received
+    kAdded,      // Packet stored, frame still incomplete
+    kCompleted,  // Packet stored and the frame is now complete
+  };
+
+  // A complete frame; access_unit->payloadUsedSize is the frame size. The
+  // access unit stays valid until the slot is reused by a newer frame or
+  // Reset is called (the caller may set its timestamps)
+  struct Frame {
+    uint32_t frame_sequence;
+    vvdecAccessUnit* access_unit;
+  };
+
+  // payload_size_hint is the expected stride, used only to preallocate
+  explicit FrameAssembler(size_t slot_count = kDefaultSlotCount,
+                          size_t payload_size_hint = kDefaultPayloadSize);
+  ~FrameAssembler();
+
+  FrameAssembler(const FrameAssembler&) = delete;
+  FrameAssembler& operator=(const FrameAssembler&) = delete;
+
+  // Store one packet's payload (header fields in host byte order)
+  // On kCompleted, frame describes the assembled frame
+  AddResult AddPacket(uint32_t frame_sequence, uint16_t packet_index,
+                      uint16_t total_packets, const uint8_t* payload,
+                      size_t payload_size, Frame* frame);
+
+  // Exchange the access unit of complete frame frame_sequence with
+  // access_unit, so the frame can outlive its slot without a copy. The slot
+  // keeps the given access unit (its payload must come from
+  // vvdec_accessUnit_alloc_payload) and grows it for later frames as needed;
+  // the Frame returned by AddPacket no longer refers to the frame
+  // Returns false if frame_sequence is not a complete frame
+  bool TakeAccessUnit(uint32_t frame_sequence, vvdecAccessUnit* access_unit);
+
+  // Number of packets received so far for frame_sequence (0 if it has no slot)
+  uint32_t GetReceivedPackets(uint32_t frame_sequence) const;
+
+  // Drop incomplete frames whose first packet arrived more than max_age ago
+  // Returns the number of frames dropped
+  size_t ExpireIncompleteFrames(std::chrono::milliseconds max_age);
+
+  // Forget all frames (arenas are kept)
+  void Reset();
+
+ private:
+  struct Slot {
+    bool in_use;                    // Holds a frame (complete or not)
+    bool complete;                  // All packets received
+    uint32_t frame_sequence;        // Frame occupying the slot
+    uint16_t total_packets;         // Expected total packets
+    uint32_t received_packets;      // Number of packets received
+    size_t stride;                  // Payload of every packet but the last, 0 until known
+    size_t last_payload_size;       // Payload of the final packet
+    std::vector<uint8_t> held_last; // Final packet received before the stride
+    std::chrono::steady_clock::time_point start_time;  // First packet arrival
+    std::vector<uint64_t> received; // One bit per packet
+    vvdecAccessUnit access_unit;    // Payload holds total_packets * stride bytes
+  };
+
+  // Take over slot for a new frame, evicting the previous occupant
+  void StartFrame(Slot* slot, uint32_t frame_sequence, uint16_t total_packets);
+
+  // Make the slot's payload hold at least size bytes
+  // Returns false if size exceeds kMaxFrameSize or the payload could not be
+  // grown (the slot is released)
+  bool ReserveArena(Slot* slot, size_t size);
+
+  // Set the frame's stride from a packet that is not the last one, and
+  // place a held last packet
+  // Returns false if the stride does not fit the frame or makes it exceed
+  // kMaxFrameSize (the slot is released)
+  bool SetStride(Slot* slot, size_t stride);
+
+  std::vector<Slot> slots_;
+  size_t payload_size_hint_;
+};
+
+#endif  // CODEC_FRAME_ASSEMBLER_H
@@ -1,159 +1,244 @@
 #include "frame_capture.h"
 
+#include <algorithm>
 #include <thread>
 #include <chrono>
 
 #include "log_system/log_system.h"
 
+bool ParseChromaFormat(int value, vvencChromaFormat* format) {
+  switch (value) {
+    case 420:
+      *format = VVENC_CHROMA_420;
+      return true;
+    case 422:
+      *format = VVENC_CHROMA_422;
+      return true;
+    case 444:
+      *format = VVENC_CHROMA_444;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static const char* ChromaFormatName(vvencChromaFormat format) {
+  switch (format) {
+    case VVENC_CHROMA_422:
+      return "4:2:2";
+    case VVENC_CHROMA_444:
+      return "4:4:4";
+    default:
+      return "4:2:0";
+  }
+}
+
 FrameCapture::FrameCapture()
-    : width_(0),
-      height_(0),
-      encoder_ready_(false),
-      frame_ready_(false),
+    : source_type_(FrameSourceType::kFile),
+      loop_frame_count_(kDefaultLoopFrameCount),
+      buffer_count_(kDefaultBufferCount),
+      fps_(0),
+      dropped_frames_(0),
       stop_requested_(false),
       eof_reached_(false),
-      frame_available_(false) {
-  vvenc_YUVBuffer_default(&frame_buffer_);
-}
+      use_io_uring_(false),
+      use_mmap_(false) {}
 
 FrameCapture::~FrameCapture() {
   Stop();
-  
-  // Only free buffer if it was allocated
-  if (frame_buffer_.planes[0].ptr) {
-    vvenc_YUVBuffer_free_buffer(&frame_buffer_);
-    // Clear the pointer to avoid double free
-    frame_buffer_.planes[0].ptr = nullptr;
-    frame_buffer_.planes[1].ptr = nullptr;
-    frame_buffer_.planes[2].ptr = nullptr;
-  }
-  
-  if (yuv_file_input_.isOpen()) {
-    yuv_file_input_.close();
+  FreeBuffers();
+}
+
+void FrameCapture::SetBufferCount(int buffer_count) {
+  if (!frame_buffers_.empty()) {
+    LOG(WARNING) << "[FrameCapture] Buffer count must be set before Initialize";
+    return;
+  }
+  buffer_count_ = std::max(1, buffer_count);
+}
+
+void FrameCapture::SetInputFormat(int bit_depth,
+                                  vvencChromaFormat chroma_format) {
+  if (!frame_buffers_.empty()) {
+    LOG(WARNING) << "[FrameCapture] Input format must be set before Initialize";
+    return;
+  }
+  if (bit_depth != 8 && bit_depth != 10) {
+    LOG(WARNING) << "[FrameCapture] Unsupported bit depth " << bit_depth
+                 << ", using " << kDefaultInputBitDepth;
+    bit_depth = kDefaultInputBitDepth;
   }
+  format_.bit_depth = bit_depth;
+  format_.chroma_format = chroma_format;
 }
 
 int FrameCapture::Initialize(const std::string& input_file, int width,
                               int height) {
   input_file_ = input_file;
-  width_ = width;
-  height_ = height;
-
-  // Open input file
-  if (0 != yuv_file_input_.open(input_file)) {
-    error_message_ = "Failed to open input file: " + yuv_file_input_.getLastError();
+  format_.width = width;
+  format_.height = height;
+  format_.fps = fps_;
+
+  // Open the frame source, which may replace the format with its own
+  source_ = CreateSource();
+  if (0 != source_->Open(&format_)) {
+    error_message_ = "Failed to open " + std::string(FrameSourceTypeName(source_type_)) +
+                     " source: " + source_->GetLastError();
     LOG(ERROR) << "[FrameCapture] " << error_message_;
+    source_.reset();
     return -1;
   }
+  if (fps_ > 0 && format_.fps > 0) {
+    fps_ = format_.fps;
+  }
 
-  // Allocate frame buffer
-  vvenc_YUVBuffer_alloc_buffer(&frame_buffer_, kFileChromaFormat, width_, height_);
+  // Allocate the buffer pool, every buffer starts out free
+  FreeBuffers();
+  frame_buffers_.resize(buffer_count_);
+  free_queue_ = std::make_unique<SpscQueue<vvencYUVBuffer*>>(buffer_count_);
+  filled_queue_ = std::make_unique<SpscQueue<vvencYUVBuffer*>>(buffer_count_);
+  for (vvencYUVBuffer& frame_buffer : frame_buffers_) {
+    vvenc_YUVBuffer_default(&frame_buffer);
+    vvenc_YUVBuffer_alloc_buffer(&frame_buffer, format_.chroma_format,
+                                 format_.width, format_.height);
+    free_queue_->TryPush(&frame_buffer);
+  }
 
-  encoder_ready_ = false;  // Start by signaling ready for first frame
-  frame_ready_ = false;
   stop_requested_ = false;
   eof_reached_ = false;
 
-  LOG(INFO) << "[FrameCapture] Initialized with file: " << input_file_
-            << " resolution: " << width_ << "x" << height_;
+  LOG(INFO) << "[FrameCapture] Initialized with " << FrameSourceTypeName(source_type_)
+            << " source: " << (source_type_ == FrameSourceType::kSynthetic ? "-" : input_file_)
+            << " resolution: " << format_.width << "x" << format_.height
+            << " format: " << format_.bit_depth << "-bit "
+            << ChromaFormatName(format_.chroma_format)
+            << " buffers: " << buffer_count_;
 
   return 0;
 }
 
+std::unique_ptr<FrameSource> FrameCapture::CreateSource() const {
+  switch (source_type_) {
+    case FrameSourceType::kSynthetic:
+      return std::make_unique<SyntheticFrameSource>();
+    case FrameSourceType::kPipe:
+      return std::make_unique<PipeFrameSource>(input_file_);
+    case FrameSourceType::kLoop:
+      return std::make_unique<LoopingFrameSource>(
+          std::make_unique<FileFrameSource>(input_file_, use_mmap_, use_io_uring_),
+          loop_frame_count_);
+    default:
+      return std::make_unique<FileFrameSource>(input_file_, use_mmap_, use_io_uring_);
+  }
+}
+
+void FrameCapture::FreeBuffers() {
+  for (vvencYUVBuffer& frame_buffer : frame_buffers_) {
+    if (frame_buffer.planes[0].ptr) {
+      vvenc_YUVBuffer_free_buffer(&frame_buffer);
+    }
+  }
+  frame_buffers_.clear();
+}
+
 void FrameCapture::Run() {
-  LOG(INFO) << "[FrameCapture] Frame capture thread started";
+  LOG(INFO) << "[FrameCapture] Frame capture thread started"
+            << (fps_ > 0 ? ", pacing at " + std::to_string(fps_) + " fps" : "");
 
   int64_t sequence_number = 0;
+  int64_t capture_tick = 0;
+  vvencYUVBuffer* frame_buffer = nullptr;
+  dropped_frames_ = 0;
+  clock_.Start(fps_);
 
   while (!stop_requested_ && !eof_reached_) {
-    // Wait for encoder to be ready
-    {
-      std::unique_lock<std::mutex> lock(mutex_);
-      encoder_ready_cv_.wait(lock, [this]() {
-        return encoder_ready_.load() || stop_requested_ || eof_reached_;
-      });
-
-      if (stop_requested_ || eof_reached_) {
-        break;
-      }
+    // Wait for the encoder to hand back a buffer (a dropped frame's buffer
+    // is reused directly)
+    if (!frame_buffer && (!free_queue_->Pop(&frame_buffer) || stop_requested_)) {
+      break;
     }
 
-    // TODO: later control fps interval
-    // std::this_thread::sleep_for(std::chrono::seconds(1));
-
     // Read next frame
     bool bEof = false;
-    if (0 != yuv_file_input_.readYuvBuf(frame_buffer_, bEof)) {
-      error_message_ = "Read YUV file failed: " + yuv_file_input_.getLastError();
+    if (0 != source_->ReadFrame(frame_buffer, &bEof)) {
+      if (stop_requested_) {
+        break;  // interrupted by Stop
+      }
+      error_message_ = source_->GetLastError();
       LOG(ERROR) << "[FrameCapture] " << error_message_;
       stop_requested_ = true;
       break;
     }
 
     if (bEof) {
-      LOG(INFO) << "[FrameCapture] Reached end of file";
+      LOG(INFO) << "[FrameCapture] Reached end of input";
       eof_reached_ = true;
       break;
     }
 
-    // Signal that frame is ready
-    {
-      std::unique_lock<std::mutex> lock(mutex_);
-      frame_available_ = true;
-      frame_ready_ = true;
-      encoder_ready_ = false;  // Wait for encoder to process
+    // Release the frame at its capture deadline; if its slot is already
+    // over, the source has moved on and the frame is lost
+    clock_.WaitForFrame(capture_tick);
+    if (clock_.IsFrameMissed(capture_tick)) {
+      LOG(WARNING) << "[FrameCapture] Dropped late frame at tick " << capture_tick;
+      dropped_frames_++;
+      capture_tick++;
+      continue;
+    }
+    frame_buffer->cts = static_cast<uint64_t>(capture_tick);
+    frame_buffer->ctsValid = true;
+    capture_tick++;
+
+    // Pass the frame to the encoder (fails only once stopped)
+    if (!filled_queue_->Push(frame_buffer)) {
+      break;
     }
-    frame_ready_cv_.notify_one();
+    frame_buffer = nullptr;
 
     LOG(INFO) << "[FrameCapture] Frame " << sequence_number << " ready";
 
     sequence_number++;
   }
 
-  // Signal EOF to encoder
-  {
-    std::unique_lock<std::mutex> lock(mutex_);
-    frame_ready_ = true;
-    frame_available_ = false;  // No more frames
+  // Return a buffer held for a dropped frame to the pool
+  if (frame_buffer) {
+    free_queue_->TryPush(frame_buffer);
   }
-  frame_ready_cv_.notify_one();
 
-  LOG(INFO) << "[FrameCapture] Frame capture thread finished. Total frames: "
-            << sequence_number;
-}
+  // Signal EOF to encoder, frames already queued are still delivered
+  filled_queue_->Close();
 
-void FrameCapture::SignalEncoderReady() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  encoder_ready_ = true;
-  frame_ready_ = false;
-  frame_available_ = false;
-  encoder_ready_cv_.notify_one();
+  LOG(INFO) << "[FrameCapture] Frame capture thread finished. Total frames: "
+            << sequence_number << " dropped: " << dropped_frames_.load();
 }
 
 vvencYUVBuffer* FrameCapture::WaitForFrame() {
-  std::unique_lock<std::mutex> lock(mutex_);
-  frame_ready_cv_.wait(lock, [this]() {
-    return frame_ready_.load() || stop_requested_ || eof_reached_;
-  });
-
-  if (stop_requested_ || (eof_reached_ && !frame_available_)) {
+  vvencYUVBuffer* frame_buffer = nullptr;
+  if (stop_requested_ || !filled_queue_->Pop(&frame_buffer)) {
     return nullptr;
   }
+  return frame_buffer;
+}
 
-  if (frame_available_) {
-    return &frame_buffer_;
+void FrameCapture::ReleaseFrame(vvencYUVBuffer* frame_buffer) {
+  if (frame_buffer) {
+    free_queue_->Push(frame_buffer);
   }
-
-  return nullptr;
 }
 
 void FrameCapture::Stop() {
-  std::unique_lock<std::mutex> lock(mutex_);
   stop_requested_ = true;
-  encoder_ready_ = true;  // Wake up waiting threads
-  frame_ready_ = true;
-  encoder_ready_cv_.notify_all();
-  frame_ready_cv_.notify_all();
+  // Wake up a read waiting on the source
+  if (source_) {
+    source_->Interrupt();
+  }
+  // Wake up waiting threads
+  if (free_queue_) {
+    free_queue_->Close();
+  }
+  if (filled_queue_) {
+    filled_queue_->Close();
+  }
 }
 
 bool FrameCapture::IsStopped() const { return stop_requested_.load(); }
@@ -161,4 +246,3 @@ bool FrameCapture::IsStopped() const { return stop_requested_.load(); }
 bool FrameCapture::IsEof() const { return eof_reached_.load(); }
 
 std::string FrameCapture::GetError() const { return error_message_; }
-
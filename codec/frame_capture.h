@@ -2,34 +2,105 @@
 #define FRAME_CAPTURE_H
 
 #include <atomic>
-#include <condition_variable>
-#include <mutex>
+#include <memory>
 #include <string>
+#include <vector>
 
-#include "tools/yuv_file_io.h"
+#include "frame_source.h"
+#include "tools/capture_clock.h"
+#include "tools/spsc_queue.h"
 #include "vvenc/vvenc.h"
 
-const vvencChromaFormat kFileChromaFormat = VVENC_CHROMA_420;
-
+// Default input format: 8-bit 4:2:0
+const int kDefaultInputBitDepth = 8;
+const vvencChromaFormat kDefaultInputChromaFormat = VVENC_CHROMA_420;
+
+// Parse a chroma format given as 420, 422 or 444
+// Returns true on success, false if the value is unsupported
+bool ParseChromaFormat(int value, vvencChromaFormat* format);
+
+// FrameCapture reads frames from a FrameSource (the input file, a looped
+// in-memory copy of it or generated content) into a pool of K YUV buffers
+// on its own thread.
+// Empty buffers travel to the capture thread and filled ones to the encoder
+// through two SPSC queues, so up to K - 1 frames are read ahead while the
+// encoder works on the current one. The encoder passes the buffer straight
+// to vvenc_encode and hands it back with ReleaseFrame.
+//
+// With a frame rate set, frames are released at fps deadlines like a live
+// source: a frame that misses its slot (no free buffer or a slow read
+// until the next frame is due) is dropped instead of delaying the rest.
+// Each frame's cts is its capture tick, the frame index at fps, so
+// dropped frames leave gaps; CaptureClock gives the matching time.
 class FrameCapture {
  public:
+  // Default number of pooled frame buffers
+  static constexpr int kDefaultBufferCount = 3;
+
+  // Default number of frames the loop source preloads
+  static constexpr int kDefaultLoopFrameCount = 30;
+
   FrameCapture();
   ~FrameCapture();
 
   // Initialize frame capture with input file and buffer dimensions
+  // (input_file is ignored by the synthetic source; a Y4M stream's header
+  // overrides the dimensions and input format, see GetFormat)
   int Initialize(const std::string& input_file, int width, int height);
 
+  // Format of the frames being captured, valid after Initialize. The
+  // encoder must be configured with it
+  const FrameFormat& GetFormat() const { return format_; }
+
+  // Select the frame source. Must be called before Initialize
+  void SetSourceType(FrameSourceType source_type) { source_type_ = source_type; }
+
+  // Number of input file frames the loop source preloads and repeats.
+  // Must be called before Initialize
+  void SetLoopFrameCount(int frame_count) { loop_frame_count_ = frame_count; }
+
+  // Read the input file through io_uring with read-ahead (falls back to
+  // blocking reads if unavailable). Must be called before Initialize
+  void SetIoUringEnabled(bool enabled) { use_io_uring_ = enabled; }
+
+  // Read the input file through a memory mapping (takes precedence over
+  // io_uring, falls back to stream reads if the file cannot be mapped).
+  // Must be called before Initialize
+  void SetMmapEnabled(bool enabled) { use_mmap_ = enabled; }
+
+  // Set the input file's sample format: bit_depth 8, or 10 for 2-byte
+  // little-endian samples, and its chroma format. Buffers are allocated in
+  // the same format, so the encoder must be configured to match.
+  // Must be called before Initialize
+  void SetInputFormat(int bit_depth, vvencChromaFormat chroma_format);
+
+  // Set the number of pooled frame buffers (at least 2 for any read-ahead).
+  // Must be called before Initialize
+  void SetBufferCount(int buffer_count);
+
+  // Pace capture at fps frames per second, or at the stream's own rate if
+  // it has one (0 reads as fast as the encoder takes frames). Must be
+  // called before Initialize
+  void SetFrameRate(int fps) { fps_ = fps; }
+
+  // Capture clock of the current run, to relate a frame's cts to the time
+  // it was captured
+  const CaptureClock& GetClock() const { return clock_; }
+
+  // Number of frames dropped because they missed their capture slot
+  int64_t GetDroppedFrames() const { return dropped_frames_.load(); }
+
   // Run the frame capture loop (to be called in a separate thread)
   void Run();
 
-  // Signal that encoder is ready for next frame
-  void SignalEncoderReady();
-
-  // Wait for encoder to be ready, then get the next frame buffer pointer
-  // Returns pointer to frame buffer if available, nullptr if EOF or error
-  // Caller should copy the frame data before signaling ready for next frame
+  // Wait for the next captured frame; the caller owns the buffer until it
+  // passes it to ReleaseFrame
+  // Returns nullptr on EOF, stop or error
   vvencYUVBuffer* WaitForFrame();
 
+  // Return a buffer obtained from WaitForFrame to the pool
+  void ReleaseFrame(vvencYUVBuffer* frame_buffer);
+
   // Signal that frame capture should stop
   void Stop();
 
@@ -43,25 +114,35 @@ class FrameCapture {
   std::string GetError() const;
 
  private:
-  YuvFileIO yuv_file_input_;
+  // Free the pooled buffers
+  void FreeBuffers();
+
+  // Create the frame source selected by source_type_
+  std::unique_ptr<FrameSource> CreateSource() const;
+
+  std::unique_ptr<FrameSource> source_;
+  FrameSourceType source_type_;
+  int loop_frame_count_;
   std::string input_file_;
-  int width_;
-  int height_;
-  vvencYUVBuffer frame_buffer_;
-
-  // Synchronization
-  std::mutex mutex_;
-  std::condition_variable encoder_ready_cv_;
-  std::condition_variable frame_ready_cv_;
-  std::atomic<bool> encoder_ready_;
-  std::atomic<bool> frame_ready_;
+  FrameFormat format_;
+
+  // Buffer pool and the queues cycling it (free: encoder -> capture,
+  // filled: capture -> encoder)
+  int buffer_count_;
+  std::vector<vvencYUVBuffer> frame_buffers_;
+  std::unique_ptr<SpscQueue<vvencYUVBuffer*>> free_queue_;
+  std::unique_ptr<SpscQueue<vvencYUVBuffer*>> filled_queue_;
+
+  // Capture pacing
+  int fps_;
+  CaptureClock clock_;
+  std::atomic<int64_t> dropped_frames_;
+
   std::atomic<bool> stop_requested_;
   std::atomic<bool> eof_reached_;
   std::string error_message_;
-
-  // Frame reading state
-  bool frame_available_;
+  bool use_io_uring_;
+  bool use_mmap_;
 };
 
 #endif  // FRAME_CAPTURE_H
-
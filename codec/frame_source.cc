@@ -0,0 +1,630 @@
+#include "frame_source.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_system/log_system.h"
+
+bool ParseFrameSourceType(const std::string& name, FrameSourceType* type) {
+  if (name == "file") {
+    *type = FrameSourceType::kFile;
+  } else if (name == "loop") {
+    *type = FrameSourceType::kLoop;
+  } else if (name == "synthetic") {
+    *type = FrameSourceType::kSynthetic;
+  } else if (name == "pipe") {
+    *type = FrameSourceType::kPipe;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* FrameSourceTypeName(FrameSourceType type) {
+  switch (type) {
+    case FrameSourceType::kFile:
+      return "file";
+    case FrameSourceType::kLoop:
+      return "loop";
+    case FrameSourceType::kSynthetic:
+      return "synthetic";
+    case FrameSourceType::kPipe:
+      return "pipe";
+  }
+  return "unknown";
+}
+
+// ====================================================================================================================
+// FileFrameSource
+
+FileFrameSource::FileFrameSource(const std::string& path, bool use_mmap,
+                                 bool use_io_uring)
+    : path_(path), use_mmap_(use_mmap), use_io_uring_(use_io_uring) {}
+
+FileFrameSource::~FileFrameSource() {
+  if (yuv_file_input_.isOpen()) {
+    yuv_file_input_.close();
+  }
+}
+
+int FileFrameSource::Open(FrameFormat* format) {
+  // The mapped reader only handles 8-bit 4:2:0
+  if (use_mmap_ && (format->bit_depth != 8 || format->chroma_format != VVENC_CHROMA_420)) {
+    LOG(WARNING) << "[FileFrameSource] Mapped input supports 8-bit 4:2:0 only, "
+                 << "using stream reads";
+  } else if (use_mmap_) {
+    if (0 != mmap_input_.Open(path_, format->width, format->height)) {
+      LOG(WARNING) << "[FileFrameSource] Cannot map input file ("
+                   << mmap_input_.GetLastError() << "), using stream reads";
+    }
+  }
+  if (mmap_input_.IsOpen()) {
+    return 0;
+  }
+
+  yuv_file_input_.setFormat(format->bit_depth, format->chroma_format,
+                            format->chroma_format);
+  if (0 != yuv_file_input_.open(path_, use_io_uring_)) {
+    last_error_ = "Failed to open input file: " + yuv_file_input_.getLastError();
+    return -1;
+  }
+  return 0;
+}
+
+int FileFrameSource::ReadFrame(vvencYUVBuffer* buffer, bool* eof) {
+  int ret = mmap_input_.IsOpen() ? mmap_input_.ReadNextFrame(buffer, eof)
+                                 : yuv_file_input_.readYuvBuf(*buffer, *eof);
+  if (ret != 0) {
+    last_error_ = "Read YUV file failed: " + (mmap_input_.IsOpen()
+                                                  ? mmap_input_.GetLastError()
+                                                  : yuv_file_input_.getLastError());
+  }
+  return ret;
+}
+
+// ====================================================================================================================
+// LoopingFrameSource
+
+LoopingFrameSource::LoopingFrameSource(std::unique_ptr<FrameSource> source,
+                                       int frame_count)
+    : source_(std::move(source)),
+      frame_count_(std::max(1, frame_count)),
+      next_frame_(0) {}
+
+LoopingFrameSource::~LoopingFrameSource() { FreeFrames(); }
+
+void LoopingFrameSource::FreeFrames() {
+  for (vvencYUVBuffer& frame : frames_) {
+    vvenc_YUVBuffer_free_buffer(&frame);
+  }
+  frames_.clear();
+}
+
+int LoopingFrameSource::Open(FrameFormat* format) {
+  FreeFrames();
+  if (0 != source_->Open(format)) {
+    last_error_ = source_->GetLastError();
+    return -1;
+  }
+
+  // Preload up to frame_count_ frames, fewer if the source ends first
+  frames_.reserve(frame_count_);
+  for (int i = 0; i < frame_count_; i++) {
+    vvencYUVBuffer frame;
+    vvenc_YUVBuffer_default(&frame);
+    vvenc_YUVBuffer_alloc_buffer(&frame, format->chroma_format, format->width,
+                                 format->height);
+    bool eof = false;
+    if (0 != source_->ReadFrame(&frame, &eof) || eof) {
+      vvenc_YUVBuffer_free_buffer(&frame);
+      if (!eof) {
+        last_error_ = source_->GetLastError();
+        FreeFrames();
+        return -1;
+      }
+      break;
+    }
+    frames_.push_back(frame);
+  }
+  source_.reset();
+
+  if (frames_.empty()) {
+    last_error_ = "source has no frames to loop";
+    return -1;
+  }
+  next_frame_ = 0;
+  LOG(INFO) << "[LoopingFrameSource] Looping " << frames_.size()
+            << " preloaded frames";
+  return 0;
+}
+
+int LoopingFrameSource::ReadFrame(vvencYUVBuffer* buffer, bool* eof) {
+  *eof = false;
+  const vvencYUVBuffer& frame = frames_[next_frame_];
+  for (int comp = 0; comp < 3; comp++) {
+    const vvencYUVPlane& src = frame.planes[comp];
+    const vvencYUVPlane& dst = buffer->planes[comp];
+    if (src.width != dst.width || src.height != dst.height) {
+      last_error_ = "buffer size does not match the preloaded frames";
+      return -1;
+    }
+    for (int y = 0; y < src.height; y++) {
+      std::memcpy(dst.ptr + y * dst.stride, src.ptr + y * src.stride,
+                  src.width * sizeof(int16_t));
+    }
+  }
+  next_frame_ = (next_frame_ + 1) % frames_.size();
+  return 0;
+}
+
+// ====================================================================================================================
+// PipeFrameSource
+
+static constexpr char kY4mSignature[] = "YUV4MPEG2 ";
+static constexpr size_t kY4mSignatureSize = sizeof(kY4mSignature) - 1;
+static constexpr size_t kPipeReadChunk = 64 * 1024;
+
+// Read-only streambuf over a memory block, to feed readYuvPlane
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  MemoryStreamBuf(uint8_t* data, size_t size) {
+    char* begin = reinterpret_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+};
+
+PipeFrameSource::PipeFrameSource(const std::string& path)
+    : path_(path),
+      fd_(-1),
+      restore_flags_(-1),
+      wake_fds_{-1, -1},
+      interrupted_(false),
+      connected_(false),
+      wait_for_writer_(false),
+      y4m_(false),
+      frame_size_(0),
+      pending_pos_(0) {}
+
+PipeFrameSource::~PipeFrameSource() { Close(); }
+
+void PipeFrameSource::Close() {
+  if (fd_ == STDIN_FILENO) {
+    if (restore_flags_ >= 0) {
+      fcntl(fd_, F_SETFL, restore_flags_);
+    }
+  } else if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = -1;
+  restore_flags_ = -1;
+  for (int& fd : wake_fds_) {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+}
+
+int PipeFrameSource::Open(FrameFormat* format) {
+  Close();
+  interrupted_ = false;
+  connected_ = false;
+  wait_for_writer_ = false;
+  pending_.clear();
+  pending_pos_ = 0;
+
+  if (path_ == "-") {
+    fd_ = STDIN_FILENO;
+    restore_flags_ = fcntl(fd_, F_GETFL);
+    if (restore_flags_ < 0 || fcntl(fd_, F_SETFL, restore_flags_ | O_NONBLOCK) < 0) {
+      last_error_ = std::string("failed to make stdin non-blocking: ") + strerror(errno);
+      return -1;
+    }
+  } else {
+    // Non-blocking open does not wait for a FIFO writer to appear
+    fd_ = open(path_.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+      last_error_ = "failed to open " + path_ + ": " + strerror(errno);
+      return -1;
+    }
+    struct stat st;
+    wait_for_writer_ = fstat(fd_, &st) == 0 && S_ISFIFO(st.st_mode);
+  }
+
+  if (pipe(wake_fds_) < 0) {
+    last_error_ = std::string("failed to create wakeup pipe: ") + strerror(errno);
+    Close();
+    return -1;
+  }
+  for (int fd : wake_fds_) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+
+  // Detect Y4M from its signature, raw bytes stay pending for the first frame
+  while (pending_.size() < kY4mSignatureSize) {
+    int ret = Fill();
+    if (ret <= 0) {
+      if (ret == 0) {
+        last_error_ = "stream ended before the first frame";
+      }
+      Close();
+      return -1;
+    }
+  }
+  y4m_ = std::memcmp(pending_.data(), kY4mSignature, kY4mSignatureSize) == 0;
+  if (y4m_) {
+    pending_pos_ = kY4mSignatureSize;
+    std::string header;
+    bool eof = false;
+    if (0 != ReadLine(&header, &eof) || eof || 0 != ParseY4mHeader(header, format)) {
+      if (eof) {
+        last_error_ = "stream ended inside the Y4M header";
+      }
+      Close();
+      return -1;
+    }
+  }
+
+  if (format->width <= 0 || format->height <= 0) {
+    last_error_ = "invalid resolution";
+    Close();
+    return -1;
+  }
+
+  const size_t bytes_per_sample = format->bit_depth > 8 ? 2 : 1;
+  const int csx = format->chroma_format == VVENC_CHROMA_444 ? 0 : 1;
+  const int csy = format->chroma_format == VVENC_CHROMA_420 ? 1 : 0;
+  frame_size_ = bytes_per_sample *
+                (static_cast<size_t>(format->width) * format->height +
+                 2 * static_cast<size_t>(format->width >> csx) * (format->height >> csy));
+  frame_data_.resize(frame_size_);
+  format_ = *format;
+
+  LOG(INFO) << "[PipeFrameSource] Reading " << (y4m_ ? "Y4M" : "raw YUV") << " from "
+            << (path_ == "-" ? "stdin" : path_) << ": " << format->width << "x"
+            << format->height << " " << format->bit_depth << "-bit"
+            << (format->fps > 0 ? " " + std::to_string(format->fps) + " fps" : "");
+  return 0;
+}
+
+int PipeFrameSource::ParseY4mHeader(const std::string& header, FrameFormat* format) {
+  std::istringstream params(header);
+  std::string param;
+  while (params >> param) {
+    const char tag = param[0];
+    const std::string value = param.substr(1);
+    if (tag == 'W') {
+      format->width = std::atoi(value.c_str());
+    } else if (tag == 'H') {
+      format->height = std::atoi(value.c_str());
+    } else if (tag == 'F') {
+      int num = 0;
+      int den = 0;
+      if (std::sscanf(value.c_str(), "%d:%d", &num, &den) == 2 && num > 0 && den > 0) {
+        // Fractional rates (e.g. 30000:1001) are rounded
+        format->fps = (num + den / 2) / den;
+      }
+    } else if (tag == 'C') {
+      // e.g. 420jpeg, 420mpeg2, 422, 444p10
+      format->bit_depth = 8;
+      if (value.compare(0, 3, "420") == 0) {
+        format->chroma_format = VVENC_CHROMA_420;
+      } else if (value.compare(0, 3, "422") == 0) {
+        format->chroma_format = VVENC_CHROMA_422;
+      } else if (value.compare(0, 3, "444") == 0) {
+        format->chroma_format = VVENC_CHROMA_444;
+      } else {
+        last_error_ = "unsupported Y4M colorspace " + value;
+        return -1;
+      }
+      // High bit depths carry a pNN suffix (not to be confused with 420paldv)
+      if (value.size() > 4 && value[3] == 'p' && std::isdigit(static_cast<unsigned char>(value[4]))) {
+        format->bit_depth = std::atoi(value.c_str() + 4);
+        if (format->bit_depth != 8 && format->bit_depth != 10) {
+          last_error_ = "unsupported Y4M bit depth " + value;
+          return -1;
+        }
+      }
+    }
+    // Interlacing, aspect ratio and extensions do not affect the samples
+  }
+  return 0;
+}
+
+int PipeFrameSource::ReadFrame(vvencYUVBuffer* buffer, bool* eof) {
+  *eof = false;
+  if (y4m_) {
+    std::string frame_header;
+    if (0 != ReadLine(&frame_header, eof)) {
+      return -1;
+    }
+    if (*eof) {
+      return 0;
+    }
+    if (frame_header.compare(0, 5, "FRAME") != 0) {
+      last_error_ = "invalid Y4M frame header";
+      return -1;
+    }
+  }
+  if (0 != ReadExact(frame_data_.data(), frame_size_, eof)) {
+    return -1;
+  }
+  if (*eof) {
+    return 0;
+  }
+
+  MemoryStreamBuf frame_buf(frame_data_.data(), frame_size_);
+  std::istream frame_stream(&frame_buf);
+  for (int comp = 0; comp < 3; comp++) {
+    if (!readYuvPlane(frame_stream, buffer->planes[comp], comp, format_.bit_depth,
+                      format_.chroma_format, format_.chroma_format)) {
+      last_error_ = "buffer size does not match the stream format";
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void PipeFrameSource::Interrupt() {
+  interrupted_ = true;
+  if (wake_fds_[1] >= 0) {
+    char byte = 1;
+    if (write(wake_fds_[1], &byte, 1) < 0) {
+      // Pipe full, a wakeup is already pending
+    }
+  }
+}
+
+int PipeFrameSource::Fill() {
+  // Drop consumed bytes before appending
+  if (pending_pos_ > 0) {
+    pending_.erase(pending_.begin(), pending_.begin() + pending_pos_);
+    pending_pos_ = 0;
+  }
+
+  bool hung_up = false;
+  while (true) {
+    if (interrupted_) {
+      last_error_ = "interrupted";
+      return -1;
+    }
+
+    const size_t size = pending_.size();
+    pending_.resize(size + kPipeReadChunk);
+    ssize_t n = read(fd_, pending_.data() + size, kPipeReadChunk);
+    pending_.resize(size + std::max<ssize_t>(n, 0));
+    if (n > 0) {
+      connected_ = true;
+      return 1;
+    }
+    if (n == 0 && (connected_ || !wait_for_writer_ || hung_up)) {
+      return 0;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      last_error_ = "read from " + path_ + " failed: " + strerror(errno);
+      return -1;
+    }
+
+    // Nothing available yet, wait for data or an interrupt. A FIFO opened
+    // by path reads as end of stream until its first writer connects; poll()
+    // waits through that, and reports a hangup once a writer has left
+    struct pollfd fds[2] = {{fd_, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+    int ready = poll(fds, 2, -1);
+    if (ready < 0 && errno != EINTR) {
+      last_error_ = std::string("poll failed: ") + strerror(errno);
+      return -1;
+    }
+    hung_up = ready > 0 && (fds[0].revents & POLLHUP) != 0;
+  }
+}
+
+int PipeFrameSource::ReadExact(uint8_t* dst, size_t size, bool* eof) {
+  *eof = false;
+  size_t done = 0;
+  while (done < size) {
+    if (pending_pos_ == pending_.size()) {
+      int ret = Fill();
+      if (ret < 0) {
+        return -1;
+      }
+      if (ret == 0) {
+        if (done > 0) {
+          LOG(WARNING) << "[PipeFrameSource] Stream ended inside a frame ("
+                       << done << " of " << size << " bytes)";
+        }
+        *eof = true;
+        return 0;
+      }
+    }
+    size_t chunk = std::min(size - done, pending_.size() - pending_pos_);
+    std::memcpy(dst + done, pending_.data() + pending_pos_, chunk);
+    pending_pos_ += chunk;
+    done += chunk;
+  }
+  return 0;
+}
+
+int PipeFrameSource::ReadLine(std::string* line, bool* eof) {
+  *eof = false;
+  line->clear();
+  while (true) {
+    auto begin = pending_.begin() + pending_pos_;
+    auto newline = std::find(begin, pending_.end(), '\n');
+    line->append(begin, newline);
+    if (newline != pending_.end()) {
+      pending_pos_ = (newline - pending_.begin()) + 1;
+      return 0;
+    }
+    pending_pos_ = pending_.size();
+    int ret = Fill();
+    if (ret < 0) {
+      return -1;
+    }
+    if (ret == 0) {
+      *eof = true;
+      return 0;
+    }
+  }
+}
+
+// ====================================================================================================================
+// SyntheticFrameSource
+
+// Text layout in luma samples
+static constexpr int kLineHeight = 16;
+static constexpr int kGlyphWidth = 8;
+static constexpr int kGlyphTop = 3;
+static constexpr int kGlyphBottom = 13;
+static constexpr int kTextMargin = 32;
+static constexpr int kMaxLineLength = 100;
+static constexpr int kScrollSpeed = 2;  // samples per frame
+static constexpr int kTitleBarHeight = 20;
+
+// Cheap integer mix, enough to make glyphs and line lengths look random
+static inline uint32_t Hash(uint32_t a, uint32_t b) {
+  uint32_t h = a * 0x9e3779b1u ^ (b + 0x7f4a7c15u + (a << 6) + (a >> 2));
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  h *= 0x297a2d39u;
+  h ^= h >> 15;
+  return h;
+}
+
+// Position along [0, range] bouncing back and forth
+static inline int Bounce(int64_t t, int range) {
+  if (range <= 0) {
+    return 0;
+  }
+  int64_t p = t % (2 * static_cast<int64_t>(range));
+  return static_cast<int>(p <= range ? p : 2 * range - p);
+}
+
+// Moving window rectangle, in luma samples
+struct WindowRect {
+  int x, y, width, height;
+};
+
+static WindowRect GetWindowRect(int width, int height, int64_t frame_index) {
+  WindowRect rect;
+  rect.width = width / 3;
+  rect.height = height / 3;
+  rect.x = Bounce(frame_index * 4, width - rect.width);
+  rect.y = Bounce(frame_index * 3, height - rect.height);
+  return rect;
+}
+
+SyntheticFrameSource::SyntheticFrameSource()
+    : bit_depth_(8), width_(0), height_(0), frame_index_(0) {}
+
+int SyntheticFrameSource::Open(FrameFormat* format) {
+  if (format->width <= 0 || format->height <= 0) {
+    last_error_ = "invalid resolution";
+    return -1;
+  }
+  bit_depth_ = format->bit_depth;
+  width_ = format->width;
+  height_ = format->height;
+  frame_index_ = 0;
+  LOG(INFO) << "[SyntheticFrameSource] Generating " << width_ << "x" << height_
+            << " " << bit_depth_ << "-bit frames";
+  return 0;
+}
+
+int SyntheticFrameSource::ReadFrame(vvencYUVBuffer* buffer, bool* eof) {
+  *eof = false;
+  if (buffer->planes[0].width != width_ || buffer->planes[0].height != height_) {
+    last_error_ = "buffer size does not match the source resolution";
+    return -1;
+  }
+  DrawLuma(buffer->planes[0]);
+  DrawChroma(buffer->planes[1], 1);
+  DrawChroma(buffer->planes[2], 2);
+  frame_index_++;
+  return 0;
+}
+
+void SyntheticFrameSource::DrawLuma(const vvencYUVPlane& plane) const {
+  const int shift = bit_depth_ - 8;
+  const int64_t scroll = frame_index_ * kScrollSpeed;
+  const WindowRect window = GetWindowRect(width_, height_, frame_index_);
+
+  for (int y = 0; y < plane.height; y++) {
+    int16_t* row = plane.ptr + y * plane.stride;
+
+    // Light background, slightly darker to the right
+    for (int x = 0; x < plane.width; x++) {
+      row[x] = static_cast<int16_t>((235 - x * 35 / plane.width) << shift);
+    }
+
+    // Document text, one glyph row per sample row
+    const int64_t doc_y = y + scroll;
+    const uint32_t line = static_cast<uint32_t>(doc_y / kLineHeight);
+    const int glyph_row = static_cast<int>(doc_y % kLineHeight);
+    if (glyph_row >= kGlyphTop && glyph_row < kGlyphBottom) {
+      const int line_length = static_cast<int>(Hash(line, 0) % kMaxLineLength);
+      const int columns =
+          std::min(line_length, (plane.width - kTextMargin) / kGlyphWidth);
+      for (int c = 0; c < columns; c++) {
+        const uint32_t glyph = Hash(line, c + 1);
+        if ((glyph & 7) == 0) {
+          continue;  // space
+        }
+        const uint32_t bits = Hash(glyph, glyph_row);
+        int16_t* cell = row + kTextMargin + c * kGlyphWidth;
+        for (int x = 0; x < kGlyphWidth - 1; x++) {
+          if ((bits >> x) & 1) {
+            cell[x] = static_cast<int16_t>(40 << shift);
+          }
+        }
+      }
+    }
+
+    // Window on top: dark title bar, gradient body
+    if (y >= window.y && y < window.y + window.height) {
+      const bool title_bar = y < window.y + kTitleBarHeight;
+      for (int x = window.x; x < window.x + window.width; x++) {
+        int value = title_bar ? 60 : 90 + (x - window.x) * 120 / window.width;
+        row[x] = static_cast<int16_t>(value << shift);
+      }
+    }
+  }
+}
+
+void SyntheticFrameSource::DrawChroma(const vvencYUVPlane& plane, int comp) const {
+  const int shift = bit_depth_ - 8;
+  const int scale_x = width_ / std::max(1, plane.width);
+  const int scale_y = height_ / std::max(1, plane.height);
+  const WindowRect window = GetWindowRect(width_, height_, frame_index_);
+  const int x0 = window.x / scale_x;
+  const int x1 = (window.x + window.width) / scale_x;
+  const int y0 = window.y / scale_y;
+  const int y1 = (window.y + window.height) / scale_y;
+  const int title_end = (window.y + kTitleBarHeight) / scale_y;
+
+  for (int y = 0; y < plane.height; y++) {
+    int16_t* row = plane.ptr + y * plane.stride;
+    for (int x = 0; x < plane.width; x++) {
+      row[x] = static_cast<int16_t>(128 << shift);
+    }
+    // Tinted window body
+    if (y >= title_end && y >= y0 && y < y1) {
+      for (int x = x0; x < x1; x++) {
+        int tint = (x - x0) * 48 / std::max(1, x1 - x0);
+        int value = comp == 1 ? 150 + tint : 110 - tint;
+        row[x] = static_cast<int16_t>(value << shift);
+      }
+    }
+  }
+}
@@ -0,0 +1,174 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tools/yuv_file_io.h"
+#include "tools/yuv_mmap_reader.h"
+#include "vvenc/vvenc.h"
+
+// Where FrameCapture gets its frames from
+enum class FrameSourceType {
+  kFile,       // Stream the YUV file once
+  kLoop,       // Preload the first frames of the YUV file and repeat them
+  kSynthetic,  // Generate screen-share-like content, no input file
+  kPipe,       // Stream raw YUV or Y4M from stdin or a named pipe
+};
+
+// Parse a frame source name ("file", "loop", "synthetic", "pipe")
+// Returns true on success, false if the name is unknown
+bool ParseFrameSourceType(const std::string& name, FrameSourceType* type);
+
+// Get the name of a frame source type
+const char* FrameSourceTypeName(FrameSourceType type);
+
+// Format of the frames a source produces
+struct FrameFormat {
+  int width = 0;
+  int height = 0;
+  int fps = 0;  // 0 if unknown
+  int bit_depth = 8;
+  vvencChromaFormat chroma_format = VVENC_CHROMA_420;
+};
+
+// Producer of raw frames for FrameCapture. Frames are written into
+// vvencYUVBuffers allocated for the format returned by Open; sources only
+// run on the capture thread, except Interrupt.
+class FrameSource {
+ public:
+  virtual ~FrameSource() = default;
+
+  // Prepare to produce frames of the requested format. Sources carrying
+  // their own format (Y4M headers) update format with it
+  // Returns 0 on success, negative value on error (see GetLastError)
+  virtual int Open(FrameFormat* format) = 0;
+
+  // Fill buffer with the next frame; eof is set (and 0 returned) when the
+  // source has no more frames
+  // Returns 0 on success, negative value on error
+  virtual int ReadFrame(vvencYUVBuffer* buffer, bool* eof) = 0;
+
+  // Make a blocked or later ReadFrame return with an error, so a stalled
+  // producer cannot hold up shutdown. Thread safe
+  virtual void Interrupt() {}
+
+  std::string GetLastError() const { return last_error_; }
+
+ protected:
+  std::string last_error_;
+};
+
+// Raw YUV file, read through a memory mapping (8-bit 4:2:0 only),
+// io_uring or blocking stream reads
+class FileFrameSource : public FrameSource {
+ public:
+  FileFrameSource(const std::string& path, bool use_mmap, bool use_io_uring);
+  ~FileFrameSource() override;
+
+  int Open(FrameFormat* format) override;
+  int ReadFrame(vvencYUVBuffer* buffer, bool* eof) override;
+
+ private:
+  std::string path_;
+  bool use_mmap_;
+  bool use_io_uring_;
+  YuvFileIO yuv_file_input_;
+  YuvMmapReader mmap_input_;
+};
+
+// Preloads the first frame_count frames of another source into memory and
+// replays them forever, for long runs without disk I/O
+class LoopingFrameSource : public FrameSource {
+ public:
+  LoopingFrameSource(std::unique_ptr<FrameSource> source, int frame_count);
+  ~LoopingFrameSource() override;
+
+  int Open(FrameFormat* format) override;
+  int ReadFrame(vvencYUVBuffer* buffer, bool* eof) override;
+
+ private:
+  void FreeFrames();
+
+  std::unique_ptr<FrameSource> source_;
+  int frame_count_;
+  std::vector<vvencYUVBuffer> frames_;
+  size_t next_frame_;
+};
+
+// Raw YUV or Y4M stream from stdin ("-") or a named pipe, e.g. the output
+// of a capture process. Y4M is detected from its signature; its header
+// sets the resolution, frame rate, bit depth and chroma format. The
+// descriptor is non-blocking and waits go through poll() together with a
+// wakeup pipe, so Interrupt ends a read even while the producer is stalled.
+class PipeFrameSource : public FrameSource {
+ public:
+  explicit PipeFrameSource(const std::string& path);
+  ~PipeFrameSource() override;
+
+  int Open(FrameFormat* format) override;
+  int ReadFrame(vvencYUVBuffer* buffer, bool* eof) override;
+  void Interrupt() override;
+
+ private:
+  // Wait for the stream to become readable and append what is available to
+  // pending_
+  // Returns 1 on data, 0 at end of stream, negative value on error or
+  // interrupt
+  int Fill();
+
+  // Read exactly size bytes, from pending_ first
+  // Returns 0 on success (eof set if the stream ended first), negative
+  // value on error or interrupt
+  int ReadExact(uint8_t* dst, size_t size, bool* eof);
+
+  // Read up to and excluding the next '\n'
+  // Returns 0 on success (eof set if the stream ended first), negative
+  // value on error or interrupt
+  int ReadLine(std::string* line, bool* eof);
+
+  // Parse a Y4M stream header (without the signature) into format
+  // Returns 0 on success, negative value on unsupported parameters
+  int ParseY4mHeader(const std::string& header, FrameFormat* format);
+
+  void Close();
+
+  std::string path_;
+  int fd_;
+  int restore_flags_;  // stdin's file status flags, -1 when not stdin
+  int wake_fds_[2];
+  std::atomic<bool> interrupted_;
+  bool connected_;  // data has been read, so a 0-byte read means the end
+  bool wait_for_writer_;  // FIFO opened by path, may have no writer yet
+  bool y4m_;
+  FrameFormat format_;
+  size_t frame_size_;
+  std::vector<uint8_t> frame_data_;
+  std::vector<uint8_t> pending_;
+  size_t pending_pos_;
+};
+
+// Generated content resembling a screen share at any resolution: a text
+// document scrolling upwards over a light gradient, with a window moving
+// across it. Endless
+class SyntheticFrameSource : public FrameSource {
+ public:
+  SyntheticFrameSource();
+
+  int Open(FrameFormat* format) override;
+  int ReadFrame(vvencYUVBuffer* buffer, bool* eof) override;
+
+ private:
+  void DrawLuma(const vvencYUVPlane& plane) const;
+  void DrawChroma(const vvencYUVPlane& plane, int comp) const;
+
+  int bit_depth_;
+  int width_;
+  int height_;
+  int64_t frame_index_;
+};
+
+#endif  // FRAME_SOURCE_H
@@ -0,0 +1,259 @@
+#include "frame_writer.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include "log_system/log_system.h"
+#include "tools/yuv_file_io.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Header of every frame but the first, which also carries the stream header
+static const char kY4mFrameHeader[] = "FRAME\n";
+
+FrameWriter::FrameWriter()
+    : fd_(-1),
+      flush_interval_(kDefaultFlushIntervalMs),
+      pending_(kMaxPendingFrames),
+      pending_count_(0),
+      failed_(false),
+      batches_(0),
+      syscalls_(0),
+      bytes_written_(0) {}
+
+FrameWriter::~FrameWriter() {
+  Stop();
+}
+
+void FrameWriter::SetFlushInterval(std::chrono::milliseconds interval) {
+  if (fd_ >= 0) {
+    LOG(WARNING) << "[FrameWriter] Flush interval must be set before Start";
+    return;
+  }
+  flush_interval_ = std::max(interval, std::chrono::milliseconds(0));
+}
+
+int FrameWriter::Start(const std::string& path) {
+  if (fd_ >= 0) {
+    LOG(WARNING) << "[FrameWriter] Already started";
+    return 0;
+  }
+
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    LOG(ERROR) << "[FrameWriter] Failed to open " << path << ": " << strerror(errno);
+    return -1;
+  }
+  path_ = path;
+
+  // Every frame the writer holds fits into the return queue, so returning
+  // one never waits on the decode thread
+  queue_ = std::make_unique<SpscQueue<QueuedFrame>>(kQueueDepth);
+  written_ = std::make_unique<SpscQueue<vvdecFrame*>>(
+      queue_->Capacity() + kMaxPendingFrames + 1);
+  pending_count_ = 0;
+  failed_ = false;
+  stats_ = StageStats();
+  batches_ = 0;
+  syscalls_ = 0;
+  bytes_written_ = 0;
+
+  thread_.Start([this]() { Run(); });
+
+  LOG(INFO) << "[FrameWriter] Writing " << path << ", flush interval: "
+            << flush_interval_.count() << " ms";
+  return 0;
+}
+
+bool FrameWriter::Write(uint32_t frame_sequence, vvdecFrame* frame) {
+  if (!queue_) {
+    return false;
+  }
+  return queue_->Push({frame_sequence, frame, std::chrono::steady_clock::now()});
+}
+
+bool FrameWriter::TakeWrittenFrame(vvdecFrame** frame) {
+  return written_ && written_->TryPop(frame);
+}
+
+int FrameWriter::Stop() {
+  if (fd_ < 0) {
+    return 0;
+  }
+  // Queued frames are still written
+  queue_->Close();
+  thread_.Join();
+
+  if (close(fd_) != 0) {
+    LOG(ERROR) << "[FrameWriter] Failed to close " << path_ << ": " << strerror(errno);
+    failed_ = true;
+  }
+  fd_ = -1;
+  return failed_ ? -1 : 0;
+}
+
+void FrameWriter::Run() {
+  LOG(INFO) << "[FrameWriter] Write thread started";
+
+  QueuedFrame item;
+  for (;;) {
+    auto wait_start = std::chrono::steady_clock::now();
+    if (pending_count_ > 0) {
+      // Write the batch once its flush interval has passed, even if no
+      // further frame arrives
+      if (!queue_->PopUntil(&item, pending_since_ + flush_interval_)) {
+        auto start = std::chrono::steady_clock::now();
+        stats_.RecordIdle(start - wait_start);
+        WritePending();
+        stats_.RecordBusy(std::chrono::steady_clock::now() - start);
+        continue;
+      }
+    } else if (!queue_->Pop(&item)) {
+      break;
+    }
+    auto start = std::chrono::steady_clock::now();
+    stats_.RecordIdle(start - wait_start);
+    stats_.RecordItem(queue_->Size(), item.queued_at, start);
+
+    if (pending_count_ == 0) {
+      pending_since_ = start;
+    }
+    AddPending(item);
+    // Keep collecting while more frames are queued, unless the batch is full
+    if (pending_count_ == pending_.size() ||
+        (start - pending_since_ >= flush_interval_ && queue_->IsEmpty())) {
+      WritePending();
+    }
+    stats_.RecordBusy(std::chrono::steady_clock::now() - start);
+  }
+
+  WritePending();
+  LOG(INFO) << "[FrameWriter] Write thread finished. Frames: " << stats_.GetItems();
+}
+
+void FrameWriter::AddPending(const QueuedFrame& item) {
+  PendingFrame& pending = pending_[pending_count_++];
+  pending.frame_sequence = item.frame_sequence;
+  pending.frame = item.frame;
+  pending.staging.clear();
+
+  const vvdecFrame* frame = item.frame;
+  // writeYUVToFile writes all planes with the widest sample size; planes
+  // already in that size are written from the picture directly
+  uint32_t bytes_per_sample = 1;
+  for (uint32_t c = 0; c < frame->numPlanes; c++) {
+    bytes_per_sample = std::max(frame->planes[c].bytesPerSample, bytes_per_sample);
+  }
+  bool direct = true;
+  for (uint32_t c = 0; c < frame->numPlanes; c++) {
+    direct = direct && frame->planes[c].bytesPerSample == bytes_per_sample;
+  }
+
+  if (!direct) {
+    std::ostringstream oss;
+    writeYUVToFile(&oss, item.frame, true, false);
+    pending.staging = oss.str();
+    return;
+  }
+  if (frame->sequenceNumber == 0) {
+    std::ostringstream oss;
+    writeY4MHeader(&oss, item.frame);
+    pending.header = oss.str();
+  } else {
+    pending.header.assign(kY4mFrameHeader, sizeof(kY4mFrameHeader) - 1);
+  }
+}
+
+void FrameWriter::WritePending() {
+  if (pending_count_ == 0) {
+    return;
+  }
+
+  iovecs_.clear();
+  for (size_t i = 0; i < pending_count_; i++) {
+    PendingFrame& pending = pending_[i];
+    if (!pending.staging.empty()) {
+      iovecs_.push_back({pending.staging.data(), pending.staging.size()});
+      continue;
+    }
+    iovecs_.push_back({pending.header.data(), pending.header.size()});
+    const vvdecFrame* frame = pending.frame;
+    for (uint32_t c = 0; c < frame->numPlanes; c++) {
+      const vvdecPlane& plane = frame->planes[c];
+      size_t row_size = static_cast<size_t>(plane.width) * plane.bytesPerSample;
+      if (plane.stride == row_size) {
+        iovecs_.push_back({plane.ptr, row_size * plane.height});
+        continue;
+      }
+      for (uint32_t y = 0; y < plane.height; y++) {
+        iovecs_.push_back({plane.ptr + static_cast<size_t>(y) * plane.stride, row_size});
+      }
+    }
+  }
+
+  if (WriteVectors() != 0) {
+    LOG(ERROR) << "[FrameWriter] Failed to write frames " << pending_[0].frame_sequence
+               << " to " << pending_[pending_count_ - 1].frame_sequence << ": "
+               << strerror(errno);
+    failed_ = true;
+  } else {
+    LOG(VERBOSE) << "[FrameWriter] Wrote " << pending_count_ << " frames up to "
+                 << pending_[pending_count_ - 1].frame_sequence;
+  }
+  batches_++;
+
+  // Hand the frames back for release (the queue holds all of them)
+  for (size_t i = 0; i < pending_count_; i++) {
+    written_->Push(pending_[i].frame);
+    pending_[i].frame = nullptr;
+  }
+  pending_count_ = 0;
+}
+
+int FrameWriter::WriteVectors() {
+  struct iovec* iov = iovecs_.data();
+  size_t remaining = iovecs_.size();
+  while (remaining > 0) {
+    int count = static_cast<int>(std::min<size_t>(remaining, IOV_MAX));
+    ssize_t written = writev(fd_, iov, count);
+    syscalls_++;
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (written == 0) {
+      errno = EIO;
+      return -1;
+    }
+    bytes_written_ += static_cast<uint64_t>(written);
+    // Skip what was written, resuming inside a partially written vector
+    size_t left = static_cast<size_t>(written);
+    while (remaining > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      iov++;
+      remaining--;
+    }
+    if (remaining > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+  return 0;
+}
+
+void FrameWriter::PrintStats() const {
+  LOG(INFO) << "[FrameWriter] Write stage: " << stats_.ToString()
+            << " batches=" << batches_ << " frames/batch="
+            << (batches_ ? static_cast<double>(stats_.GetItems()) / batches_ : 0.0)
+            << " writev=" << syscalls_ << " bytes=" << bytes_written_;
+}
@@ -0,0 +1,119 @@
+#ifndef CODEC_FRAME_WRITER_H
+#define CODEC_FRAME_WRITER_H
+
+#include <sys/uio.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tools/spsc_queue.h"
+#include "tools/stage_stats.h"
+#include "tools/thread_manager.h"
+#include "vvdec/vvdec.h"
+
+// FrameWriter writes decoded frames to a Y4M file on a thread of its own.
+// It takes over the decoder's reference to each vvdec frame and, instead
+// of copying the picture, points iovecs straight at its plane rows. Frames
+// are collected until flush_interval has passed since the first pending
+// one (whether or not more frames arrive), kMaxPendingFrames are pending
+// or the writer stops, and then go out together in as few writev() calls
+// as IOV_MAX allows. Nothing is flushed per frame.
+// A written frame comes back through TakeWrittenFrame, since vvdec frames
+// may only be unreferenced on the thread calling vvdec_decode.
+// Write and TakeWrittenFrame must be called from one thread (the decode
+// thread), or from any thread once Stop has returned.
+class FrameWriter {
+ public:
+  // Frames queued between the decode and write threads
+  static constexpr int kQueueDepth = 4;
+  // Frames held for one batch at most (each keeps its vvdec picture)
+  static constexpr int kMaxPendingFrames = 8;
+  // Default time frames may wait to be batched
+  static constexpr int kDefaultFlushIntervalMs = 100;
+
+  FrameWriter();
+  ~FrameWriter();
+
+  FrameWriter(const FrameWriter&) = delete;
+  FrameWriter& operator=(const FrameWriter&) = delete;
+
+  // Set how long frames may wait to be batched (0 writes as soon as the
+  // queue runs empty). Must be called before Start
+  void SetFlushInterval(std::chrono::milliseconds interval);
+
+  // Create or truncate path and start the write thread
+  // Returns 0 on success, negative value on error
+  int Start(const std::string& path);
+
+  // Queue a decoded frame, waiting while the write thread is behind
+  // Returns false if the writer is not running (the caller keeps the frame)
+  bool Write(uint32_t frame_sequence, vvdecFrame* frame);
+
+  // Take a frame that has been written, for the caller to unreference
+  // Returns false if there is none
+  bool TakeWrittenFrame(vvdecFrame** frame);
+
+  // Write the pending frames, stop the thread and close the file
+  // Returns 0 on success, negative value if any write failed
+  int Stop();
+
+  // Log queue, batch and syscall statistics
+  void PrintStats() const;
+
+ private:
+  // Frame queued for the write thread
+  struct QueuedFrame {
+    uint32_t frame_sequence;
+    vvdecFrame* frame;
+    std::chrono::steady_clock::time_point queued_at;
+  };
+
+  // Frame waiting for the next batch; header is the Y4M frame header (with
+  // the stream header before the first frame), staging holds the whole
+  // frame for the rare formats that cannot be written from the planes
+  struct PendingFrame {
+    uint32_t frame_sequence;
+    vvdecFrame* frame;
+    std::string header;
+    std::string staging;
+  };
+
+  // Write thread main loop
+  void Run();
+
+  // Add a frame to the pending batch
+  void AddPending(const QueuedFrame& item);
+
+  // Write the pending batch and return its frames
+  void WritePending();
+
+  // writev() all of iovecs_, resuming after partial writes
+  // Returns 0 on success, negative value on error
+  int WriteVectors();
+
+  int fd_;
+  std::string path_;
+  std::chrono::milliseconds flush_interval_;
+  std::unique_ptr<SpscQueue<QueuedFrame>> queue_;     // decode -> write
+  std::unique_ptr<SpscQueue<vvdecFrame*>> written_;   // write -> decode
+  Thread thread_;
+
+  // Write thread state
+  std::vector<PendingFrame> pending_;
+  size_t pending_count_;
+  std::chrono::steady_clock::time_point pending_since_;
+  std::vector<struct iovec> iovecs_;
+  bool failed_;
+
+  // Statistics, read once stopped
+  StageStats stats_;
+  uint64_t batches_;
+  uint64_t syscalls_;
+  uint64_t bytes_written_;
+};
+
+#endif  // CODEC_FRAME_WRITER_H
@@ -0,0 +1,153 @@
+#include "picture_buffer_pool.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+#include "log_system/log_system.h"
+
+PictureBufferPool::~PictureBufferPool() {
+  if (in_use_ > 0) {
+    // vvdec_decoder_close unreferences every buffer, so this is a bug
+    LOG(WARNING) << "[PictureBufferPool] " << in_use_ << " buffers still in use";
+  }
+  for (Buffer* buffer : free_) {
+    Free(buffer);
+  }
+}
+
+void* PictureBufferPool::CreateBuffer(void* opaque, vvdecComponentType component,
+                                      uint32_t size, uint32_t alignment, void** allocator) {
+  PictureBufferPool* pool = static_cast<PictureBufferPool*>(opaque);
+  Buffer* buffer = pool->Acquire(component, size, alignment);
+  if (buffer == nullptr) {
+    LOG(ERROR) << "[PictureBufferPool] Failed to allocate " << size << " bytes";
+    return nullptr;
+  }
+  *allocator = buffer;
+  return buffer->data;
+}
+
+void PictureBufferPool::UnrefBuffer(void* opaque, void* allocator) {
+  static_cast<PictureBufferPool*>(opaque)->Release(static_cast<Buffer*>(allocator));
+}
+
+PictureBufferPool::Buffer* PictureBufferPool::Acquire(vvdecComponentType component,
+                                                      size_t size, size_t alignment) {
+  std::vector<Buffer*> stale;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(free_.begin(), free_.end(), [=](const Buffer* buffer) {
+      return buffer->size == size &&
+             reinterpret_cast<uintptr_t>(buffer->data) % alignment == 0;
+    });
+    if (it != free_.end()) {
+      Buffer* buffer = *it;
+      *it = free_.back();
+      free_.pop_back();
+      in_use_++;
+      reuses_++;
+      return buffer;
+    }
+    // A miss alone only means more pictures are in flight than before. A
+    // component whose plane size changed means the picture format changed;
+    // idle buffers that fit no plane of it would never be used again
+    size_t index = static_cast<size_t>(component);
+    if (index < VVDEC_MAX_NUM_COMPONENT && plane_sizes_[index] != size) {
+      plane_sizes_[index] = size;
+      std::erase_if(free_, [&](Buffer* buffer) {
+        if (std::find(std::begin(plane_sizes_), std::end(plane_sizes_), buffer->size) !=
+            std::end(plane_sizes_)) {
+          return false;
+        }
+        reserved_bytes_ -= buffer->size;
+        purged_++;
+        stale.push_back(buffer);
+        return true;
+      });
+    }
+  }
+  for (Buffer* buffer : stale) {
+    Free(buffer);
+  }
+
+  Buffer* buffer = Allocate(size, alignment);
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  in_use_++;
+  allocations_++;
+  huge_page_buffers_ += buffer->mapped_size > 0 ? 1 : 0;
+  reserved_bytes_ += size;
+  peak_reserved_bytes_ = std::max(peak_reserved_bytes_, reserved_bytes_);
+  return buffer;
+}
+
+void PictureBufferPool::Release(Buffer* buffer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  in_use_--;
+  free_.push_back(buffer);
+}
+
+PictureBufferPool::Buffer* PictureBufferPool::Allocate(size_t size, size_t alignment) {
+  Buffer* buffer = new Buffer{nullptr, size, 0};
+  alignment = std::max(alignment, kAlignment);
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  // Whole huge pages, so the mapping can be backed by them entirely:
+  // reserved hugetlbfs pages if the system has any, else transparent huge
+  // pages (a hint the kernel may not follow)
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  if (size >= kHugePageSize && alignment <= page_size) {
+    size_t mapped_size = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    void* data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data == MAP_FAILED) {
+      data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data != MAP_FAILED) {
+        madvise(data, mapped_size, MADV_HUGEPAGE);
+      }
+    }
+    if (data != MAP_FAILED) {
+      buffer->data = data;
+      buffer->mapped_size = mapped_size;
+      return buffer;
+    }
+  }
+#endif
+
+  if (posix_memalign(&buffer->data, alignment, size) != 0) {
+    delete buffer;
+    return nullptr;
+  }
+  return buffer;
+}
+
+void PictureBufferPool::Free(Buffer* buffer) {
+  if (buffer->mapped_size > 0) {
+    munmap(buffer->data, buffer->mapped_size);
+  } else {
+    free(buffer->data);
+  }
+  delete buffer;
+}
+
+PictureBufferPool::Stats PictureBufferPool::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {allocations_, reuses_, purged_, reserved_bytes_};
+}
+
+void PictureBufferPool::PrintStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LOG(INFO) << "[PictureBufferPool] Stats: allocations=" << allocations_
+            << " reuses=" << reuses_ << " purged=" << purged_
+            << " huge_page_buffers=" << huge_page_buffers_
+            << " in_use=" << in_use_ << " free=" << free_.size()
+            << " reserved_mb=" << reserved_bytes_ / (1 << 20)
+            << " peak_reserved_mb=" << peak_reserved_bytes_ / (1 << 20);
+}
@@ -0,0 +1,96 @@
+#ifndef CODEC_PICTURE_BUFFER_POOL_H
+#define CODEC_PICTURE_BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "vvdec/vvdec.h"
+
+// Pool of picture plane buffers for vvdec, plugged in through
+// vvdec_decoder_open_with_allocator with this pool as vvdecParams::opaque.
+// vvdec asks for one buffer per plane and hands it back through the unref
+// callback once neither the decoder nor any returned vvdecFrame uses it, so
+// a frame can be passed to writers or other consumers without copying for
+// as long as it is referenced.
+// Buffers are at least 64-byte aligned. Buffers of kHugePageSize or more
+// are mapped separately and backed by huge pages (reserved hugetlbfs pages,
+// else transparent huge pages), which saves TLB misses when whole pictures
+// are streamed through. Released
+// buffers are kept for reuse by size. The pool remembers the plane size
+// last requested for each component; when one changes (the resolution or
+// chroma format changed), idle buffers that fit no current plane size are
+// freed, so memory stays flat over long sessions. Luma and chroma buffers
+// of one format never evict each other.
+// Thread safe: vvdec may allocate and unreference from its worker threads.
+class PictureBufferPool {
+ public:
+  // Minimum buffer alignment (cache line, widest SIMD load)
+  static constexpr size_t kAlignment = 64;
+  // Buffers at least this large are backed by huge pages where available
+  static constexpr size_t kHugePageSize = 2 << 20;
+
+  PictureBufferPool() = default;
+  ~PictureBufferPool();
+
+  PictureBufferPool(const PictureBufferPool&) = delete;
+  PictureBufferPool& operator=(const PictureBufferPool&) = delete;
+
+  // vvdecCreateBufferCallback; opaque is the pool
+  static void* CreateBuffer(void* opaque, vvdecComponentType component, uint32_t size,
+                            uint32_t alignment, void** allocator);
+
+  // vvdecUnrefBufferCallback; opaque is the pool
+  static void UnrefBuffer(void* opaque, void* allocator);
+
+  // Allocation and reuse counters
+  struct Stats {
+    uint64_t allocations;  // Buffers allocated
+    uint64_t reuses;       // Requests served from the free list
+    uint64_t purged;       // Idle buffers freed after a format change
+    size_t reserved_bytes;  // In use and free
+  };
+  Stats GetStats() const;
+
+  // Log allocation and reuse statistics
+  void PrintStats() const;
+
+ private:
+  // One buffer; its address is the opaque allocator pointer given to vvdec
+  struct Buffer {
+    void* data;
+    size_t size;         // Size requested by vvdec
+    size_t mapped_size;  // Size of the mapping, 0 if heap allocated
+  };
+
+  // Take a free buffer of size or allocate one for a plane of component
+  // Returns nullptr if allocation fails
+  Buffer* Acquire(vvdecComponentType component, size_t size, size_t alignment);
+
+  // Put a buffer back on the free list
+  void Release(Buffer* buffer);
+
+  // Allocate a new buffer (without the lock held)
+  // Returns nullptr on failure
+  static Buffer* Allocate(size_t size, size_t alignment);
+
+  // Free a buffer's memory and the buffer itself
+  static void Free(Buffer* buffer);
+
+  mutable std::mutex mutex_;
+  std::vector<Buffer*> free_;
+  // Plane size last requested per component, the current picture format
+  size_t plane_sizes_[VVDEC_MAX_NUM_COMPONENT] = {};
+  size_t in_use_ = 0;
+  size_t reserved_bytes_ = 0;  // In use and free
+
+  // Statistics
+  uint64_t allocations_ = 0;
+  uint64_t reuses_ = 0;
+  uint64_t purged_ = 0;
+  uint64_t huge_page_buffers_ = 0;
+  size_t peak_reserved_bytes_ = 0;
+};
+
+#endif  // CODEC_PICTURE_BUFFER_POOL_H
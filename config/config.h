@@ -25,6 +25,75 @@ struct FlagInitializer {
                          "input YUV video file for sender");
     parser.AddStringFlag("output_video_file", "result/output.266",
                          "output encoded video file for receiver");
+    parser.AddStringFlag("input_source", "file",
+                         "sender frame source: file (read input_video_file "
+                         "once), loop (preload loop_frames frames of it and "
+                         "repeat them), synthetic (generated screen-share "
+                         "content, no file) or pipe (raw YUV or Y4M streamed "
+                         "from input_video_file as a named pipe, - for stdin)");
+    parser.AddIntFlag("loop_frames", 30,
+                      "frames of the input file the loop source keeps in "
+                      "memory");
+    parser.AddIntFlag("input_mmap", 0,
+                      "1 to read the input YUV file through a memory mapping "
+                      "(sender mode)");
+    parser.AddIntFlag("input_bit_depth", 8,
+                      "input YUV bit depth: 8, or 10 for 2-byte little-endian "
+                      "samples; also the coded bit depth (sender mode)");
+    parser.AddIntFlag("input_chroma_format", 420,
+                      "input YUV chroma format: 420, 422 or 444; also the "
+                      "coded chroma format (sender mode)");
+    parser.AddIntFlag("capture_pacing", 0,
+                      "0 feeds input frames as fast as the encoder takes "
+                      "them; 1 releases them at fps deadlines like a live "
+                      "source, dropping frames that miss their slot (sender mode)");
+    parser.AddIntFlag("capture_buffers", 3,
+                      "frame buffers in the capture pool; up to N-1 frames "
+                      "are read ahead while the encoder runs (sender mode)");
+    parser.AddStringFlag("send_mode", "batch",
+                         "sender packet transmit mode: packet (one send per "
+                         "packet), batch (sendmmsg per frame), gso "
+                         "(UDP_SEGMENT sendmsg per frame) or uring "
+                         "(io_uring sendmsg requests, one submit per frame)");
+    parser.AddIntFlag("zerocopy_threshold", 0,
+                      "send frames of at least this many bytes with "
+                      "MSG_ZEROCOPY (0 disables)");
+    parser.AddIntFlag("send_queue_depth", 4,
+                      "encoded frames queued between the encoder and the "
+                      "send thread (0 writes and sends on the encoder "
+                      "thread)");
+    parser.AddIntFlag("recv_batch", 32,
+                      "max datagrams the receiver reads per recvmmsg call");
+    parser.AddIntFlag("recv_gro", 0,
+                      "1 to enable UDP GRO on the receiver socket");
+    parser.AddIntFlag("recv_shards", 1,
+                      "receiver threads sharing the port via SO_REUSEPORT "
+                      "(each stream lands on one shard)");
+    parser.AddIntFlag("decode_queue_depth", 8,
+                      "access units queued between the receive and decode "
+                      "threads (0 decodes on the receive thread)");
+    parser.AddStringFlag("decode_profile", "throughput",
+                         "receiver latency profile: ultra-low-latency (no "
+                         "parse-ahead), balanced or throughput (vvdec "
+                         "defaults)");
+    parser.AddIntFlag("decode_threads", 0,
+                      "vvdec threads (0 uses the profile's choice; shards "
+                      "split the cores)");
+    parser.AddIntFlag("decode_buffer_pool", 1,
+                      "1 to decode into pooled, huge-page backed picture "
+                      "buffers (vvdec allocator callbacks)");
+    parser.AddIntFlag("write_flush_ms", 100,
+                      "milliseconds decoded frames may wait to be written "
+                      "to the output file in one batch (0 writes as soon as "
+                      "the write queue runs empty)");
+    parser.AddIntFlag("io_uring", 0,
+                      "1 to use io_uring for the receive socket, input YUV "
+                      "reads and decoded output writes with "
+                      "decode_queue_depth=0 (Linux)");
+    parser.AddIntFlag("recv_busy_poll_us", 0,
+                      "busy-poll receive: microseconds to keep spinning on "
+                      "the socket after the last datagram before sleeping "
+                      "(Linux, 0 disables)");
   }
 };
 
@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <vector>
 
 #include "codec/decoder.h"
 #include "codec/encoder.h"
@@ -10,9 +14,41 @@
 #include "tools/thread_manager.h"
 #include "transmission/message_receiver.h"
 #include "transmission/message_sender.h"
+#include "transmission/sharded_message_receiver.h"
 #include "transmission/decoder_with_feedback.h"
 #include "transmission/feedback_manage.h"
 
+// Incomplete frames (lost packets) are dropped this long after their first
+// packet, checked on the receive thread every kFrameExpiryInterval
+static constexpr std::chrono::milliseconds kFrameAssemblyTimeout(500);
+static constexpr std::chrono::milliseconds kFrameExpiryInterval(100);
+
+// Run frame-assembly expiry for decoder on the receiver's event loop
+static void add_frame_expiry_timer(MessageReceiver* receiver, Decoder* decoder) {
+#ifdef __linux__
+  receiver->GetEventLoop()->AddTimer(kFrameExpiryInterval, [decoder]() {
+    decoder->ExpireIncompleteFrames(kFrameAssemblyTimeout);
+  });
+#else
+  (void)receiver;
+  (void)decoder;
+#endif
+}
+
+// Log CPU time and context switches of the whole run, to compare I/O modes
+static void log_resource_usage() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return;
+  }
+  LOG(INFO) << "[socket_codec_main] Resource usage: user="
+            << usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000
+            << "ms sys="
+            << usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000
+            << "ms voluntary_ctx_switches=" << usage.ru_nvcsw
+            << " involuntary_ctx_switches=" << usage.ru_nivcsw;
+}
+
 int sender_create_and_run(CmdLineParser& parser, const std::string& dest_ip, int dest_port) {
   LOG(INFO) << "[socket_codec_main] Running in sender mode";
 
@@ -27,6 +63,34 @@ int sender_create_and_run(CmdLineParser& parser, const std::string& dest_ip, int
   int fps = parser.GetFlag<int>("fps");
   int framesToBeEncoded = parser.GetFlag<int>("frames_to_encode");
 
+  SendMode send_mode;
+  if (!ParseSendMode(parser.GetFlag<std::string>("send_mode"), &send_mode)) {
+    LOG(ERROR) << "[socket_codec_main] Invalid send_mode: "
+               << parser.GetFlag<std::string>("send_mode");
+    return -1;
+  }
+
+  int input_bit_depth = parser.GetFlag<int>("input_bit_depth");
+  if (input_bit_depth != 8 && input_bit_depth != 10) {
+    LOG(ERROR) << "[socket_codec_main] Invalid input_bit_depth: "
+               << input_bit_depth;
+    return -1;
+  }
+  FrameSourceType input_source;
+  if (!ParseFrameSourceType(parser.GetFlag<std::string>("input_source"),
+                            &input_source)) {
+    LOG(ERROR) << "[socket_codec_main] Invalid input_source: "
+               << parser.GetFlag<std::string>("input_source");
+    return -1;
+  }
+  vvencChromaFormat input_chroma_format;
+  if (!ParseChromaFormat(parser.GetFlag<int>("input_chroma_format"),
+                         &input_chroma_format)) {
+    LOG(ERROR) << "[socket_codec_main] Invalid input_chroma_format: "
+               << parser.GetFlag<int>("input_chroma_format");
+    return -1;
+  }
+
   // Open output file
   std::ofstream cOutBitstream;
   cOutBitstream.open(output_video_file,
@@ -39,6 +103,13 @@ int sender_create_and_run(CmdLineParser& parser, const std::string& dest_ip, int
 
   // Create frame capture instance
   FrameCapture frame_capture;
+  frame_capture.SetSourceType(input_source);
+  frame_capture.SetLoopFrameCount(parser.GetFlag<int>("loop_frames"));
+  frame_capture.SetIoUringEnabled(parser.GetFlag<int>("io_uring") != 0);
+  frame_capture.SetMmapEnabled(parser.GetFlag<int>("input_mmap") != 0);
+  frame_capture.SetBufferCount(parser.GetFlag<int>("capture_buffers"));
+  frame_capture.SetInputFormat(input_bit_depth, input_chroma_format);
+  frame_capture.SetFrameRate(parser.GetFlag<int>("capture_pacing") != 0 ? fps : 0);
   if (0 != frame_capture.Initialize(input_video_file, width, height)) {
     LOG(ERROR) << "[socket_codec_main] Failed to initialize frame capture";
     return -1;
@@ -50,13 +121,22 @@ int sender_create_and_run(CmdLineParser& parser, const std::string& dest_ip, int
     LOG(ERROR) << "[socket_codec_main] Failed to initialize message sender";
     return -1;
   }
+  message_sender.SetSendMode(send_mode);
+  message_sender.SetZeroCopyThreshold(
+      static_cast<size_t>(std::max(0, parser.GetFlag<int>("zerocopy_threshold"))));
   LOG(INFO) << "[socket_codec_main] Message sender initialized: " << dest_ip
             << ":" << dest_port;
 
   // Create and initialize encoder
   LOG(INFO) << "[socket_codec_main] Initializing encoder";
   Encoder encoder;
-  if (0 != encoder.Initialize(width, height, fps, framesToBeEncoded)) {
+  // Encode in the captured format, which a Y4M header may have set
+  const FrameFormat& input_format = frame_capture.GetFormat();
+  encoder.SetInputFormat(input_format.bit_depth, input_format.chroma_format);
+  encoder.SetSendQueueDepth(parser.GetFlag<int>("send_queue_depth"));
+  if (0 != encoder.Initialize(input_format.width, input_format.height,
+                              input_format.fps > 0 ? input_format.fps : fps,
+                              framesToBeEncoded)) {
     LOG(ERROR) << "[socket_codec_main] Failed to initialize encoder";
     return -1;
   }
@@ -112,6 +192,9 @@ int sender_create_and_run(CmdLineParser& parser, const std::string& dest_ip, int
 
   // Print summary before cleanup
   encoder.PrintSummary();
+  encoder.PrintStats();
+  message_sender.PrintStats();
+  log_resource_usage();
 
   // Cleanup
   encoder.SetFrameCapture(nullptr);
@@ -125,7 +208,99 @@ int sender_create_and_run(CmdLineParser& parser, const std::string& dest_ip, int
   return 0;
 }
 
+// Output file of one receiver shard: "rec.y4m" -> "rec_shard1.y4m"
+static std::string shard_output_file(const std::string& filename, int shard) {
+  std::string suffix = "_shard" + std::to_string(shard);
+  size_t dot = filename.find_last_of('.');
+  size_t slash = filename.find_last_of('/');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return filename + suffix;
+  }
+  return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
+
+int sharded_receiver_create_and_run(CmdLineParser& parser, int dest_port,
+                                    const std::string& filename, int shards,
+                                    DecoderProfile profile) {
+  int width = parser.GetFlag<int>("width");
+  int height = parser.GetFlag<int>("height");
+
+  // Shards decode concurrently, so by default they split the cores
+  int decode_threads = parser.GetFlag<int>("decode_threads");
+  if (decode_threads <= 0) {
+    int cpus = static_cast<int>(std::thread::hardware_concurrency());
+    decode_threads = std::max(1, cpus / shards);
+  }
+
+  LOG(INFO) << "[socket_codec_main] Running " << shards
+            << " receiver shards on port " << dest_port;
+
+  ShardedMessageReceiver sharded_receiver;
+  if (0 != sharded_receiver.Initialize(
+               dest_port, shards,
+               static_cast<size_t>(std::max(1, parser.GetFlag<int>("recv_batch"))),
+               parser.GetFlag<int>("recv_gro") != 0,
+               parser.GetFlag<int>("io_uring") != 0,
+               std::chrono::microseconds(parser.GetFlag<int>("recv_busy_poll_us")))) {
+    LOG(ERROR) << "[socket_codec_main] Failed to initialize sharded receiver";
+    return -1;
+  }
+
+  // Each shard decodes the streams the kernel steers to it into its own file
+  int feedback_port = dest_port + 1;
+  std::vector<std::unique_ptr<Decoder>> decoders;
+  std::vector<std::unique_ptr<DecoderWithFeedback>> handlers;
+  for (int i = 0; i < shards; i++) {
+    auto decoder = std::make_unique<Decoder>();
+    std::string shard_file = shard_output_file(filename, i);
+    decoder->SetIoUringEnabled(parser.GetFlag<int>("io_uring") != 0);
+    decoder->SetDecodeQueueDepth(parser.GetFlag<int>("decode_queue_depth"));
+    decoder->SetBufferPoolEnabled(parser.GetFlag<int>("decode_buffer_pool") != 0);
+    decoder->SetWriteFlushInterval(
+        std::chrono::milliseconds(parser.GetFlag<int>("write_flush_ms")));
+    decoder->SetProfile(profile, decode_threads);
+    if (0 != decoder->Initialize(width, height, shard_file)) {
+      LOG(ERROR) << "[socket_codec_main] Failed to initialize decoder for shard " << i;
+      return -1;
+    }
+    auto handler = std::make_unique<DecoderWithFeedback>(
+        decoder.get(), sharded_receiver.GetShard(i), feedback_port);
+    sharded_receiver.GetShard(i)->SetMessageHandler(handler.get());
+    add_frame_expiry_timer(sharded_receiver.GetShard(i), decoder.get());
+    LOG(INFO) << "[socket_codec_main] Shard " << i << " saving to " << shard_file;
+    decoders.push_back(std::move(decoder));
+    handlers.push_back(std::move(handler));
+  }
+
+  // Run shards (blocks until stopped)
+  sharded_receiver.Run();
+
+  LOG(INFO) << "[socket_codec_main] Receiver stopped";
+  sharded_receiver.PrintStats();
+  log_resource_usage();
+
+  // Cleanup
+  sharded_receiver.Close();
+  for (auto& decoder : decoders) {
+    decoder->Cleanup();
+    decoder->PrintStats();
+  }
+  return 0;
+}
+
 int receiver_create_and_run(CmdLineParser& parser, int dest_port, const std::string& filename) {
+  DecoderProfile profile;
+  if (!ParseDecoderProfile(parser.GetFlag<std::string>("decode_profile"), &profile)) {
+    LOG(ERROR) << "[socket_codec_main] Invalid decode_profile: "
+               << parser.GetFlag<std::string>("decode_profile");
+    return -1;
+  }
+
+  int shards = parser.GetFlag<int>("recv_shards");
+  if (shards > 1) {
+    return sharded_receiver_create_and_run(parser, dest_port, filename, shards, profile);
+  }
+
   LOG(INFO) << "[socket_codec_main] Running in receiver mode, saving to file: "
             << filename;
 
@@ -138,6 +313,12 @@ int receiver_create_and_run(CmdLineParser& parser, int dest_port, const std::str
   // Create and initialize decoder
   LOG(INFO) << "[socket_codec_main] Initializing decoder";
   Decoder decoder;
+  decoder.SetIoUringEnabled(parser.GetFlag<int>("io_uring") != 0);
+  decoder.SetDecodeQueueDepth(parser.GetFlag<int>("decode_queue_depth"));
+  decoder.SetBufferPoolEnabled(parser.GetFlag<int>("decode_buffer_pool") != 0);
+  decoder.SetWriteFlushInterval(
+      std::chrono::milliseconds(parser.GetFlag<int>("write_flush_ms")));
+  decoder.SetProfile(profile, parser.GetFlag<int>("decode_threads"));
   if (0 != decoder.Initialize(width, height, filename)) {
     LOG(ERROR) << "[socket_codec_main] Failed to initialize decoder";
     return -1;
@@ -146,6 +327,12 @@ int receiver_create_and_run(CmdLineParser& parser, int dest_port, const std::str
 
   // Create and initialize message receiver
   MessageReceiver message_receiver;
+  message_receiver.SetReceiveBatchSize(
+      static_cast<size_t>(std::max(1, parser.GetFlag<int>("recv_batch"))));
+  message_receiver.SetGroEnabled(parser.GetFlag<int>("recv_gro") != 0);
+  message_receiver.SetIoUringEnabled(parser.GetFlag<int>("io_uring") != 0);
+  message_receiver.SetBusyPoll(
+      std::chrono::microseconds(parser.GetFlag<int>("recv_busy_poll_us")));
   if (0 != message_receiver.Initialize(dest_port)) {
     LOG(ERROR) << "[socket_codec_main] Failed to initialize message receiver";
     decoder.Cleanup();
@@ -160,6 +347,7 @@ int receiver_create_and_run(CmdLineParser& parser, int dest_port, const std::str
 
   // Connect decoder wrapper (as message handler) to message receiver
   message_receiver.SetMessageHandler(&decoder_with_feedback);
+  add_frame_expiry_timer(&message_receiver, &decoder);
 
   LOG(INFO) << "[socket_codec_main] Message receiver initialized, listening on port "
             << dest_port;
@@ -168,10 +356,13 @@ int receiver_create_and_run(CmdLineParser& parser, int dest_port, const std::str
   message_receiver.Run();
 
   LOG(INFO) << "[socket_codec_main] Receiver stopped";
+  message_receiver.PrintStats();
+  log_resource_usage();
 
   // Cleanup
   message_receiver.Close();
   decoder.Cleanup();
+  decoder.PrintStats();
   return 0;
 }
 
@@ -0,0 +1,149 @@
+// Reuse test for the picture buffer pool
+//   make test && ./build/test_picture_buffer_pool
+// Drives the pool through its vvdec callbacks the way the decoder does:
+// every picture takes a Y, a U and a V plane, frame threads allocate a few
+// pictures at once (so luma and chroma requests interleave), and a few
+// pictures stay referenced at a time. Once warmed up, requests must be
+// served from the free list without freeing or allocating anything, a
+// deeper reference list must only add planes, and a resolution change must
+// free the old ones.
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <set>
+#include <vector>
+
+#include "codec/picture_buffer_pool.h"
+
+// ====================================================================================================================
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL %s\n", what);
+    failures++;
+  }
+}
+
+// Planes of one decoded picture, as vvdec's allocator pointers
+struct Picture {
+  void* data[VVDEC_MAX_NUM_COMPONENT];
+  void* allocator[VVDEC_MAX_NUM_COMPONENT];
+};
+
+// Picture plane sizes of 8-bit 4:2:0 with a 32-sample margin, as vvdec
+// requests them
+static void PlaneSizes(uint32_t width, uint32_t height, uint32_t sizes[]) {
+  sizes[VVDEC_CT_Y] = (width + 64) * (height + 64);
+  sizes[VVDEC_CT_U] = (width / 2 + 32) * (height / 2 + 32);
+  sizes[VVDEC_CT_V] = sizes[VVDEC_CT_U];
+}
+
+static void UnrefPicture(PictureBufferPool* pool, const Picture& picture) {
+  for (int c = 0; c < VVDEC_MAX_NUM_COMPONENT; c++) {
+    PictureBufferPool::UnrefBuffer(pool, picture.allocator[c]);
+  }
+}
+
+// Decode rounds of batch pictures whose planes are requested interleaved
+// (all Y planes, then all U, then all V), keeping up to references
+// pictures referenced, and return every plane address handed out
+static std::set<void*> Decode(PictureBufferPool* pool, std::deque<Picture>* referenced,
+                              const uint32_t sizes[], int rounds, size_t batch,
+                              size_t references) {
+  std::set<void*> planes;
+  for (int i = 0; i < rounds; i++) {
+    std::vector<Picture> pictures(batch);
+    for (int c = 0; c < VVDEC_MAX_NUM_COMPONENT; c++) {
+      for (Picture& picture : pictures) {
+        picture.data[c] = PictureBufferPool::CreateBuffer(
+            pool, static_cast<vvdecComponentType>(c), sizes[c], 32, &picture.allocator[c]);
+        Check(picture.data[c] != nullptr, "plane allocated");
+        planes.insert(picture.data[c]);
+      }
+    }
+    referenced->insert(referenced->end(), pictures.begin(), pictures.end());
+    while (referenced->size() > references) {
+      UnrefPicture(pool, referenced->front());
+      referenced->pop_front();
+    }
+  }
+  return planes;
+}
+
+static void UnrefAll(PictureBufferPool* pool, std::deque<Picture>* referenced) {
+  for (const Picture& picture : *referenced) {
+    UnrefPicture(pool, picture);
+  }
+  referenced->clear();
+}
+
+static void TestSteadyState() {
+  PictureBufferPool pool;
+  std::deque<Picture> referenced;
+  uint32_t sizes[VVDEC_MAX_NUM_COMPONENT];
+  PlaneSizes(416, 240, sizes);
+  const size_t picture_bytes = static_cast<size_t>(sizes[0]) + sizes[1] + sizes[2];
+
+  std::set<void*> warm = Decode(&pool, &referenced, sizes, 4, 2, 4);
+  PictureBufferPool::Stats warmed = pool.GetStats();
+  Check(warmed.allocations == 6 * VVDEC_MAX_NUM_COMPONENT, "warm-up allocations");
+
+  std::set<void*> steady = Decode(&pool, &referenced, sizes, 100, 2, 4);
+  PictureBufferPool::Stats after = pool.GetStats();
+  Check(after.allocations == warmed.allocations, "no allocation after warm-up");
+  Check(after.purged == 0, "no buffer freed after warm-up");
+  Check(after.reserved_bytes == warmed.reserved_bytes, "reserved bytes unchanged");
+  Check(after.reuses == warmed.reuses + 200 * VVDEC_MAX_NUM_COMPONENT, "every plane reused");
+  Check(steady == warm, "same planes handed out");
+
+  // One more referenced picture: a luma miss while chroma planes are free
+  // must only add the planes of that picture
+  Decode(&pool, &referenced, sizes, 100, 2, 5);
+  PictureBufferPool::Stats deeper = pool.GetStats();
+  Check(deeper.allocations == after.allocations + VVDEC_MAX_NUM_COMPONENT,
+        "deeper reference list allocates one picture");
+  Check(deeper.purged == 0, "deeper reference list frees nothing");
+  Check(deeper.reserved_bytes == after.reserved_bytes + picture_bytes,
+        "deeper reference list reserves one picture");
+
+  UnrefAll(&pool, &referenced);
+}
+
+static void TestFormatChange() {
+  PictureBufferPool pool;
+  std::deque<Picture> referenced;
+  uint32_t old_sizes[VVDEC_MAX_NUM_COMPONENT];
+  uint32_t new_sizes[VVDEC_MAX_NUM_COMPONENT];
+  PlaneSizes(416, 240, old_sizes);
+  PlaneSizes(832, 480, new_sizes);
+
+  Decode(&pool, &referenced, old_sizes, 4, 2, 4);
+  UnrefAll(&pool, &referenced);
+  PictureBufferPool::Stats before = pool.GetStats();
+
+  // The first picture of the new resolution frees every idle old plane
+  Decode(&pool, &referenced, new_sizes, 1, 1, 4);
+  PictureBufferPool::Stats after = pool.GetStats();
+  Check(after.purged == before.allocations, "old planes freed");
+  Check(after.reserved_bytes == static_cast<size_t>(new_sizes[0]) + new_sizes[1] + new_sizes[2],
+        "only the new picture reserved");
+
+  Decode(&pool, &referenced, new_sizes, 50, 2, 4);
+  Check(pool.GetStats().purged == after.purged, "new planes kept");
+  UnrefAll(&pool, &referenced);
+}
+
+int main() {
+  TestSteadyState();
+  TestFormatChange();
+
+  if (failures > 0) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include "capture_clock.h"
+
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <time.h>
+
+static constexpr int64_t kNsPerSecond = 1000000000;
+
+CaptureClock::CaptureClock() : fps_(0), start_ns_(0) {}
+
+void CaptureClock::Start(int fps) {
+  fps_ = fps;
+  start_ns_ = NowNs();
+}
+
+int64_t CaptureClock::NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t CaptureClock::DeadlineNs(int64_t frame_index) const {
+  if (fps_ <= 0) {
+    return start_ns_;
+  }
+  return start_ns_ + frame_index * kNsPerSecond / fps_;
+}
+
+void CaptureClock::WaitForFrame(int64_t frame_index) const {
+  if (fps_ <= 0) {
+    return;
+  }
+  int64_t deadline = DeadlineNs(frame_index);
+#ifdef __linux__
+  // steady_clock is CLOCK_MONOTONIC on Linux
+  struct timespec ts;
+  ts.tv_sec = deadline / kNsPerSecond;
+  ts.tv_nsec = deadline % kNsPerSecond;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+#else
+  std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+      std::chrono::nanoseconds(deadline)));
+#endif
+}
+
+bool CaptureClock::IsFrameMissed(int64_t frame_index) const {
+  return fps_ > 0 && NowNs() >= DeadlineNs(frame_index + 1);
+}
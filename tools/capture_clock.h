@@ -0,0 +1,38 @@
+#ifndef TOOLS_CAPTURE_CLOCK_H
+#define TOOLS_CAPTURE_CLOCK_H
+
+#include <cstdint>
+
+// Frame clock of a live source running at a fixed frame rate. Frame i is
+// due at start + i / fps on the monotonic clock; deadlines are computed
+// from the frame index, so sleeping late never accumulates drift. Waits use
+// clock_nanosleep(TIMER_ABSTIME) on Linux.
+class CaptureClock {
+ public:
+  CaptureClock();
+
+  // Start the clock now; frame 0 is due immediately
+  // fps <= 0 leaves the clock unpaced (every deadline is already due)
+  void Start(int fps);
+
+  bool IsPaced() const { return fps_ > 0; }
+
+  // Monotonic time in nanoseconds (same base as std::chrono::steady_clock)
+  static int64_t NowNs();
+
+  // Monotonic time frame_index is due at
+  int64_t DeadlineNs(int64_t frame_index) const;
+
+  // Sleep until frame_index is due (returns at once if unpaced or late)
+  void WaitForFrame(int64_t frame_index) const;
+
+  // True once the slot of frame_index is over, i.e. frame_index + 1 is due.
+  // A live source would have overwritten the frame by then
+  bool IsFrameMissed(int64_t frame_index) const;
+
+ private:
+  int fps_;
+  int64_t start_ns_;
+};
+
+#endif  // TOOLS_CAPTURE_CLOCK_H
@@ -0,0 +1,259 @@
+#include "event_loop.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "log_system/log_system.h"
+
+// Maximum events returned by one epoll_wait call
+static constexpr int kMaxEvents = 64;
+
+EventLoop::EventLoop()
+    : epoll_fd_(-1), wakeup_fd_(-1), running_(false), stop_requested_(false) {}
+
+EventLoop::~EventLoop() { Close(); }
+
+int EventLoop::Initialize() {
+  if (epoll_fd_ >= 0) {
+    LOG(WARNING) << "[EventLoop] Already initialized";
+    return 0;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    LOG(ERROR) << "[EventLoop] Failed to create epoll instance: " << strerror(errno);
+    return -1;
+  }
+
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ < 0) {
+    LOG(ERROR) << "[EventLoop] Failed to create eventfd: " << strerror(errno);
+    Close();
+    return -1;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = wakeup_fd_;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) < 0) {
+    LOG(ERROR) << "[EventLoop] Failed to watch eventfd: " << strerror(errno);
+    Close();
+    return -1;
+  }
+
+  stop_requested_ = false;
+  return 0;
+}
+
+int EventLoop::AddFd(int fd, uint32_t events, FdCallback callback) {
+  if (epoll_fd_ < 0) {
+    LOG(ERROR) << "[EventLoop] Not initialized";
+    return -1;
+  }
+  if (handlers_.count(fd) > 0) {
+    LOG(ERROR) << "[EventLoop] fd " << fd << " is already registered";
+    return -1;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = events;
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+    LOG(ERROR) << "[EventLoop] Failed to watch fd " << fd << ": " << strerror(errno);
+    return -1;
+  }
+
+  handlers_[fd] = std::make_unique<Handler>(Handler{std::move(callback), false});
+  return 0;
+}
+
+void EventLoop::RemoveFd(int fd) {
+  auto it = handlers_.find(fd);
+  if (it == handlers_.end()) {
+    return;
+  }
+
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  if (it->second->is_timer) {
+    close(fd);
+  }
+  // The handler may be the one currently executing
+  retired_handlers_.push_back(std::move(it->second));
+  handlers_.erase(it);
+}
+
+int EventLoop::AddTimer(std::chrono::microseconds interval,
+                        TimerCallback callback, bool repeat) {
+  if (epoll_fd_ < 0) {
+    LOG(ERROR) << "[EventLoop] Not initialized";
+    return -1;
+  }
+  if (interval.count() <= 0) {
+    LOG(ERROR) << "[EventLoop] Timer interval must be positive";
+    return -1;
+  }
+
+  int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd < 0) {
+    LOG(ERROR) << "[EventLoop] Failed to create timerfd: " << strerror(errno);
+    return -1;
+  }
+
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = interval.count() / 1000000;
+  spec.it_value.tv_nsec = (interval.count() % 1000000) * 1000;
+  if (repeat) {
+    spec.it_interval = spec.it_value;
+  }
+  if (timerfd_settime(timer_fd, 0, &spec, nullptr) < 0) {
+    LOG(ERROR) << "[EventLoop] Failed to arm timerfd: " << strerror(errno);
+    close(timer_fd);
+    return -1;
+  }
+
+  // Read the expiration count before running the callback, so a slow
+  // callback sees one call per wakeup rather than a backlog
+  auto on_expired = [this, timer_fd, repeat, callback = std::move(callback)](uint32_t) {
+    uint64_t expirations = 0;
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+      return;
+    }
+    if (!repeat) {
+      RemoveFd(timer_fd);
+    }
+    callback();
+  };
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = timer_fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd, &event) < 0) {
+    LOG(ERROR) << "[EventLoop] Failed to watch timerfd: " << strerror(errno);
+    close(timer_fd);
+    return -1;
+  }
+
+  handlers_[timer_fd] = std::make_unique<Handler>(Handler{std::move(on_expired), true});
+  return timer_fd;
+}
+
+void EventLoop::CancelTimer(int timer_id) {
+  auto it = handlers_.find(timer_id);
+  if (it == handlers_.end() || !it->second->is_timer) {
+    return;
+  }
+  RemoveFd(timer_id);
+}
+
+void EventLoop::Post(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    pending_tasks_.push_back(std::move(task));
+  }
+  Wakeup();
+}
+
+void EventLoop::Run() {
+  if (epoll_fd_ < 0) {
+    LOG(ERROR) << "[EventLoop] Not initialized";
+    return;
+  }
+
+  running_ = true;
+  while (!stop_requested_) {
+    if (RunOnce(-1) < 0) {
+      break;
+    }
+  }
+  running_ = false;
+}
+
+int EventLoop::RunOnce(int timeout_ms) {
+  struct epoll_event events[kMaxEvents];
+  int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+  if (count < 0) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    LOG(ERROR) << "[EventLoop] epoll_wait failed: " << strerror(errno);
+    return -1;
+  }
+
+  for (int i = 0; i < count && !stop_requested_; i++) {
+    int fd = events[i].data.fd;
+    if (fd == wakeup_fd_) {
+      HandleWakeup();
+      continue;
+    }
+    // Look the handler up per event, an earlier callback may have removed it
+    auto it = handlers_.find(fd);
+    if (it != handlers_.end()) {
+      Handler* handler = it->second.get();
+      handler->callback(events[i].events);
+    }
+  }
+  retired_handlers_.clear();
+  return count;
+}
+
+void EventLoop::Stop() {
+  stop_requested_ = true;
+  Wakeup();
+}
+
+void EventLoop::Wakeup() {
+  if (wakeup_fd_ < 0) {
+    return;
+  }
+  uint64_t one = 1;
+  // A full counter already guarantees a pending wakeup
+  if (write(wakeup_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    LOG(WARNING) << "[EventLoop] Failed to signal eventfd: " << strerror(errno);
+  }
+}
+
+void EventLoop::HandleWakeup() {
+  uint64_t value = 0;
+  while (read(wakeup_fd_, &value, sizeof(value)) == sizeof(value)) {
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(task_mutex_);
+    running_tasks_.swap(pending_tasks_);
+  }
+  for (Task& task : running_tasks_) {
+    task();
+  }
+  running_tasks_.clear();
+}
+
+void EventLoop::Close() {
+  for (auto& entry : handlers_) {
+    if (entry.second->is_timer) {
+      close(entry.first);
+    }
+  }
+  handlers_.clear();
+  retired_handlers_.clear();
+
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+    wakeup_fd_ = -1;
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+}
+
+#endif  // __linux__
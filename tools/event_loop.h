@@ -0,0 +1,100 @@
+#ifndef TOOLS_EVENT_LOOP_H
+#define TOOLS_EVENT_LOOP_H
+
+#ifdef __linux__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Single-threaded event loop multiplexing sockets, timers and wakeups
+// Built on epoll, with one timerfd per timer and an eventfd used to wake the
+// loop from other threads (Stop, Post). All callbacks run on the thread that
+// calls Run(). Linux only.
+class EventLoop {
+ public:
+  // Called with the ready epoll events (EPOLLIN, EPOLLERR, ...)
+  using FdCallback = std::function<void(uint32_t events)>;
+  using TimerCallback = std::function<void()>;
+  using Task = std::function<void()>;
+
+  EventLoop();
+  ~EventLoop();
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  // Create the epoll instance and wakeup eventfd
+  // Returns 0 on success, negative value on error
+  int Initialize();
+
+  // Watch fd for events (level-triggered)
+  // Returns 0 on success, negative value on error
+  int AddFd(int fd, uint32_t events, FdCallback callback);
+
+  // Stop watching fd (safe to call from inside its own callback)
+  void RemoveFd(int fd);
+
+  // Add a timer firing after interval, then every interval if repeat
+  // Returns timer id (>= 0) on success, negative value on error
+  int AddTimer(std::chrono::microseconds interval, TimerCallback callback,
+               bool repeat = true);
+
+  // Cancel a timer (safe to call from inside its own callback)
+  void CancelTimer(int timer_id);
+
+  // Run task on the loop thread (thread-safe, wakes the loop)
+  void Post(Task task);
+
+  // Run the loop (blocks until Stop)
+  void Run();
+
+  // Wait up to timeout_ms (-1 blocks, 0 polls) for events and dispatch them
+  // once, for callers that drive the loop themselves (e.g. busy polling)
+  // Returns the number of events dispatched, negative value on error
+  int RunOnce(int timeout_ms);
+
+  // Stop the loop (thread-safe, wakes the loop)
+  void Stop();
+
+  // Check if the loop is inside Run()
+  bool IsRunning() const { return running_.load(); }
+
+  // Close the epoll instance, eventfd and all timers
+  void Close();
+
+ private:
+  struct Handler {
+    FdCallback callback;
+    bool is_timer;
+  };
+
+  // Write to the eventfd so epoll_wait returns
+  void Wakeup();
+
+  // Drain the eventfd and run posted tasks
+  void HandleWakeup();
+
+  int epoll_fd_;
+  int wakeup_fd_;
+  std::atomic<bool> running_;
+  std::atomic<bool> stop_requested_;
+
+  // fd -> handler; handlers removed during dispatch are kept alive in
+  // retired_handlers_ until the current dispatch round ends
+  std::unordered_map<int, std::unique_ptr<Handler>> handlers_;
+  std::vector<std::unique_ptr<Handler>> retired_handlers_;
+
+  std::mutex task_mutex_;
+  std::vector<Task> pending_tasks_;
+  std::vector<Task> running_tasks_;
+};
+
+#endif  // __linux__
+
+#endif  // TOOLS_EVENT_LOOP_H
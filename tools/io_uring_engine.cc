@@ -0,0 +1,312 @@
+#include "io_uring_engine.h"
+
+#ifdef HAVE_IO_URING
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "log_system/log_system.h"
+
+static int SysIoUringSetup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int SysIoUringEnter(int ring_fd, unsigned to_submit,
+                           unsigned min_complete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+static int SysIoUringRegister(int ring_fd, unsigned opcode, const void* arg,
+                              unsigned nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+// Ring indices are shared with the kernel: loads of the kernel-written side
+// need acquire, stores of our side need release
+static unsigned LoadAcquire(unsigned* ptr) {
+  return std::atomic_ref<unsigned>(*ptr).load(std::memory_order_acquire);
+}
+
+static void StoreRelease(unsigned* ptr, unsigned value) {
+  std::atomic_ref<unsigned>(*ptr).store(value, std::memory_order_release);
+}
+
+IoUringEngine::IoUringEngine()
+    : ring_fd_(-1),
+      features_(0),
+      sq_ring_(nullptr),
+      sq_ring_size_(0),
+      cq_ring_(nullptr),
+      cq_ring_size_(0),
+      sqes_(nullptr),
+      sqes_size_(0),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_mask_(0),
+      sq_entries_(0),
+      sqe_tail_(0),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(0),
+      cq_entries_(0),
+      cqes_(nullptr),
+      buffer_ring_(nullptr),
+      buffer_ring_size_(0),
+      buffer_ring_tail_(nullptr),
+      buffer_ring_mask_(0),
+      buffer_tail_(0),
+      buffer_group_(0),
+      buffer_base_(nullptr),
+      buffer_size_(0) {}
+
+IoUringEngine::~IoUringEngine() { Close(); }
+
+bool IoUringEngine::IsSupported() {
+  static const bool supported = []() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = SysIoUringSetup(2, &params);
+    if (fd < 0) {
+      return false;
+    }
+    close(fd);
+    return true;
+  }();
+  return supported;
+}
+
+int IoUringEngine::Initialize(unsigned entries) {
+  if (ring_fd_ >= 0) {
+    LOG(WARNING) << "[IoUringEngine] Already initialized";
+    return 0;
+  }
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = SysIoUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    int err = errno;
+    LOG(WARNING) << "[IoUringEngine] io_uring_setup failed: " << strerror(err);
+    return -err;
+  }
+
+  features_ = params.features;
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    int err = errno;
+    LOG(ERROR) << "[IoUringEngine] Failed to map SQ ring: " << strerror(err);
+    Close();
+    return -err;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      int err = errno;
+      LOG(ERROR) << "[IoUringEngine] Failed to map CQ ring: " << strerror(err);
+      Close();
+      return -err;
+    }
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    int err = errno;
+    LOG(ERROR) << "[IoUringEngine] Failed to map SQEs: " << strerror(err);
+    Close();
+    return -err;
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  uint8_t* sq = static_cast<uint8_t*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sqe_tail_ = *sq_tail_;
+
+  // SQE slots are used in ring order, so the index array is the identity
+  unsigned* sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  for (unsigned i = 0; i < sq_entries_; i++) {
+    sq_array[i] = i;
+  }
+
+  uint8_t* cq = static_cast<uint8_t*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cq_entries_ = params.cq_entries;
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  stats_ = Stats();
+  return 0;
+}
+
+void IoUringEngine::Close() {
+  if (buffer_ring_ != nullptr) {
+    munmap(buffer_ring_, buffer_ring_size_);
+    buffer_ring_ = nullptr;
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+    sqes_ = nullptr;
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  cq_ring_ = nullptr;
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+    sq_ring_ = nullptr;
+  }
+  // Closing the ring also drops registered buffers, eventfd and buffer ring
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+}
+
+struct io_uring_sqe* IoUringEngine::GetSqe() {
+  if (ring_fd_ < 0 || sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+    return nullptr;
+  }
+  struct io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe_tail_++;
+  return sqe;
+}
+
+int IoUringEngine::Submit(unsigned wait_nr) {
+  if (ring_fd_ < 0) {
+    return -EBADF;
+  }
+
+  StoreRelease(sq_tail_, sqe_tail_);
+  unsigned to_submit = sqe_tail_ - LoadAcquire(sq_head_);
+  if (to_submit == 0 &&
+      (wait_nr == 0 || LoadAcquire(cq_tail_) - *cq_head_ >= wait_nr)) {
+    return 0;
+  }
+
+  unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+  int ret;
+  do {
+    stats_.enter_calls++;
+    ret = SysIoUringEnter(ring_fd_, to_submit, wait_nr, flags);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0) {
+    return -errno;
+  }
+  stats_.submitted += static_cast<uint64_t>(ret);
+  return ret;
+}
+
+bool IoUringEngine::PopCompletion(struct io_uring_cqe* cqe) {
+  if (ring_fd_ < 0) {
+    return false;
+  }
+  unsigned head = *cq_head_;
+  if (head == LoadAcquire(cq_tail_)) {
+    return false;
+  }
+  *cqe = cqes_[head & cq_mask_];
+  StoreRelease(cq_head_, head + 1);
+  stats_.completed++;
+  return true;
+}
+
+int IoUringEngine::RegisterBuffers(const struct iovec* iovecs, unsigned count) {
+  if (SysIoUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, iovecs, count) < 0) {
+    int err = errno;
+    LOG(WARNING) << "[IoUringEngine] Failed to register buffers: " << strerror(err);
+    return -err;
+  }
+  return 0;
+}
+
+int IoUringEngine::RegisterEventFd(int event_fd) {
+  if (SysIoUringRegister(ring_fd_, IORING_REGISTER_EVENTFD, &event_fd, 1) < 0) {
+    int err = errno;
+    LOG(WARNING) << "[IoUringEngine] Failed to register eventfd: " << strerror(err);
+    return -err;
+  }
+  return 0;
+}
+
+int IoUringEngine::SetupBufferRing(uint16_t group_id, uint8_t* base,
+                                   size_t buffer_size, uint16_t count) {
+  if (count == 0 || (count & (count - 1)) != 0) {
+    LOG(ERROR) << "[IoUringEngine] Buffer ring size must be a power of two";
+    return -EINVAL;
+  }
+
+  // The ring must be page aligned, anonymous memory satisfies that
+  buffer_ring_size_ = static_cast<size_t>(count) * sizeof(struct io_uring_buf);
+  void* ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring == MAP_FAILED) {
+    int err = errno;
+    LOG(ERROR) << "[IoUringEngine] Failed to allocate buffer ring: " << strerror(err);
+    return -err;
+  }
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+  reg.ring_entries = count;
+  reg.bgid = group_id;
+  if (SysIoUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    int err = errno;
+    LOG(WARNING) << "[IoUringEngine] Failed to register buffer ring: " << strerror(err);
+    munmap(ring, buffer_ring_size_);
+    return -err;
+  }
+
+  buffer_ring_ = static_cast<struct io_uring_buf*>(ring);
+  // The ring tail overlays the reserved field of the first entry
+  buffer_ring_tail_ = &buffer_ring_[0].resv;
+  buffer_ring_mask_ = static_cast<uint16_t>(count - 1);
+  buffer_tail_ = 0;
+  buffer_group_ = group_id;
+  buffer_base_ = base;
+  buffer_size_ = buffer_size;
+
+  for (uint16_t i = 0; i < count; i++) {
+    ReturnBuffer(i);
+  }
+  return 0;
+}
+
+void IoUringEngine::ReturnBuffer(uint16_t buffer_id) {
+  struct io_uring_buf* buf = &buffer_ring_[buffer_tail_ & buffer_ring_mask_];
+  buf->addr = reinterpret_cast<uint64_t>(GetBuffer(buffer_id));
+  buf->len = static_cast<uint32_t>(buffer_size_);
+  buf->bid = buffer_id;
+  buffer_tail_++;
+  std::atomic_ref<uint16_t>(*buffer_ring_tail_)
+      .store(buffer_tail_, std::memory_order_release);
+}
+
+#endif  // HAVE_IO_URING
@@ -0,0 +1,135 @@
+#ifndef TOOLS_IO_URING_ENGINE_H
+#define TOOLS_IO_URING_ENGINE_H
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#endif
+
+#ifdef HAVE_IO_URING
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+// Minimal io_uring submission/completion ring driven through the raw
+// syscalls, so no liburing dependency is needed. Supports registered
+// buffers, a provided buffer ring (for multishot receives) and an eventfd
+// completion signal that can be watched by EventLoop.
+// An engine must only be used from one thread at a time.
+class IoUringEngine {
+ public:
+  // Submission statistics
+  struct Stats {
+    uint64_t enter_calls = 0;  // io_uring_enter syscalls
+    uint64_t submitted = 0;    // SQEs consumed by the kernel
+    uint64_t completed = 0;    // CQEs consumed
+  };
+
+  IoUringEngine();
+  ~IoUringEngine();
+
+  IoUringEngine(const IoUringEngine&) = delete;
+  IoUringEngine& operator=(const IoUringEngine&) = delete;
+
+  // Check if the running kernel allows io_uring (it may be disabled by
+  // sysctl or a seccomp policy)
+  static bool IsSupported();
+
+  // Create a ring with at least entries submission slots
+  // Returns 0 on success, negative value on error
+  int Initialize(unsigned entries);
+
+  // Unregister everything and unmap the rings
+  void Close();
+
+  // Check if the ring is set up
+  bool IsInitialized() const { return ring_fd_ >= 0; }
+
+  // Number of completion queue slots
+  unsigned GetCompletionQueueSize() const { return cq_entries_; }
+
+  // Check for an IORING_FEAT_* flag reported by io_uring_setup
+  bool HasFeature(uint32_t feature) const { return (features_ & feature) != 0; }
+
+  // Get a zeroed SQE for the next request, nullptr if the queue is full
+  // (call Submit to make room)
+  struct io_uring_sqe* GetSqe();
+
+  // Hand queued SQEs to the kernel and wait for at least wait_nr
+  // completions (0 does not wait). No syscall is made if there is nothing
+  // to submit and enough completions are already queued.
+  // Returns the number of SQEs submitted, negative errno on error
+  int Submit(unsigned wait_nr = 0);
+
+  // Pop the next completion without blocking
+  // Returns true and fills cqe if one was available
+  bool PopCompletion(struct io_uring_cqe* cqe);
+
+  // Register fixed buffers for READ_FIXED / WRITE_FIXED (buf_index = slot)
+  // Returns 0 on success, negative errno on error
+  int RegisterBuffers(const struct iovec* iovecs, unsigned count);
+
+  // Signal event_fd whenever a completion is posted
+  // Returns 0 on success, negative errno on error
+  int RegisterEventFd(int event_fd);
+
+  // Register a provided buffer ring of count (power of two) buffers of
+  // buffer_size bytes carved from base, for requests with
+  // IOSQE_BUFFER_SELECT and buf_group = group_id. All buffers start owned
+  // by the kernel.
+  // Returns 0 on success, negative errno on error
+  int SetupBufferRing(uint16_t group_id, uint8_t* base, size_t buffer_size,
+                      uint16_t count);
+
+  // Give a buffer picked by the kernel (IORING_CQE_F_BUFFER) back to the ring
+  void ReturnBuffer(uint16_t buffer_id);
+
+  // Get the address of a provided buffer
+  uint8_t* GetBuffer(uint16_t buffer_id) const {
+    return buffer_base_ + static_cast<size_t>(buffer_id) * buffer_size_;
+  }
+
+  // Get submission statistics
+  const Stats& GetStats() const { return stats_; }
+
+ private:
+  int ring_fd_;
+  uint32_t features_;
+
+  // Mapped submission ring, completion ring and SQE array
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned sqe_tail_;  // Local tail, published to sq_tail_ by Submit
+
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  unsigned cq_entries_;
+  struct io_uring_cqe* cqes_;
+
+  // Provided buffer ring (one group per engine)
+  struct io_uring_buf* buffer_ring_;
+  size_t buffer_ring_size_;
+  uint16_t* buffer_ring_tail_;
+  uint16_t buffer_ring_mask_;
+  uint16_t buffer_tail_;
+  uint16_t buffer_group_;
+  uint8_t* buffer_base_;
+  size_t buffer_size_;
+
+  Stats stats_;
+};
+
+#endif  // HAVE_IO_URING
+
+#endif  // TOOLS_IO_URING_ENGINE_H
@@ -0,0 +1,305 @@
+#include "io_uring_file.h"
+
+#ifdef HAVE_IO_URING
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "log_system/log_system.h"
+
+// Two buffers in flight need at most two SQEs
+static constexpr unsigned kFileRingEntries = 4;
+
+// Register both buffers so the kernel does not pin pages per request
+// Returns true if READ_FIXED / WRITE_FIXED can be used
+static bool RegisterFileBuffers(IoUringEngine* engine, std::vector<char>* buffers) {
+  struct iovec iovecs[2];
+  for (int i = 0; i < 2; i++) {
+    iovecs[i].iov_base = buffers[i].data();
+    iovecs[i].iov_len = buffers[i].size();
+  }
+  return engine->RegisterBuffers(iovecs, 2) == 0;
+}
+
+// ====================================================================================================================
+
+IoUringReadBuffer::IoUringReadBuffer(size_t buffer_size)
+    : fd_(-1),
+      buffer_size_(buffer_size),
+      fixed_buffers_(false),
+      pending_{false, false},
+      lengths_{0, 0},
+      current_(-1),
+      file_offset_(0),
+      eof_submitted_(false) {}
+
+IoUringReadBuffer::~IoUringReadBuffer() { Close(); }
+
+int IoUringReadBuffer::Open(const std::string& path) {
+  if (fd_ >= 0) {
+    Close();
+  }
+
+  if (engine_.Initialize(kFileRingEntries) != 0) {
+    return -1;
+  }
+
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    LOG(ERROR) << "[IoUringReadBuffer] Failed to open " << path << ": " << strerror(errno);
+    engine_.Close();
+    return -1;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    buffers_[i].resize(buffer_size_);
+    pending_[i] = false;
+    lengths_[i] = 0;
+  }
+  fixed_buffers_ = RegisterFileBuffers(&engine_, buffers_);
+  current_ = -1;
+  file_offset_ = 0;
+  eof_submitted_ = false;
+  setg(nullptr, nullptr, nullptr);
+
+  // Start filling both buffers right away
+  SubmitRead(0);
+  SubmitRead(1);
+  return 0;
+}
+
+void IoUringReadBuffer::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+  // The kernel may still write into the buffers
+  for (int i = 0; i < 2; i++) {
+    WaitForRead(i);
+  }
+  close(fd_);
+  fd_ = -1;
+  engine_.Close();
+  setg(nullptr, nullptr, nullptr);
+}
+
+void IoUringReadBuffer::SubmitRead(int index) {
+  if (eof_submitted_) {
+    return;
+  }
+
+  struct io_uring_sqe* sqe = engine_.GetSqe();
+  if (sqe == nullptr) {
+    return;
+  }
+  sqe->opcode = fixed_buffers_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+  sqe->fd = fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(buffers_[index].data());
+  sqe->len = static_cast<uint32_t>(buffer_size_);
+  sqe->off = file_offset_;
+  sqe->buf_index = static_cast<uint16_t>(index);
+  sqe->user_data = static_cast<uint64_t>(index);
+  file_offset_ += buffer_size_;
+  pending_[index] = true;
+  engine_.Submit();
+}
+
+void IoUringReadBuffer::WaitForRead(int index) {
+  while (pending_[index]) {
+    if (engine_.Submit(1) < 0) {
+      LOG(ERROR) << "[IoUringReadBuffer] io_uring_enter failed";
+      pending_[index] = false;
+      lengths_[index] = -EIO;
+      return;
+    }
+    struct io_uring_cqe cqe;
+    while (engine_.PopCompletion(&cqe)) {
+      int completed = static_cast<int>(cqe.user_data);
+      pending_[completed] = false;
+      lengths_[completed] = cqe.res;
+      // A short read means the end of a regular file was reached
+      if (cqe.res < static_cast<int32_t>(buffer_size_)) {
+        eof_submitted_ = true;
+      }
+    }
+  }
+}
+
+IoUringReadBuffer::int_type IoUringReadBuffer::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  if (fd_ < 0) {
+    return traits_type::eof();
+  }
+
+  // The buffer just consumed becomes the read-ahead target
+  if (current_ >= 0) {
+    SubmitRead(current_);
+    current_ ^= 1;
+  } else {
+    current_ = 0;
+  }
+
+  WaitForRead(current_);
+  int32_t length = lengths_[current_];
+  if (length < 0) {
+    LOG(ERROR) << "[IoUringReadBuffer] Read failed: " << strerror(-length);
+  }
+  if (length <= 0) {
+    lengths_[current_] = 0;
+    return traits_type::eof();
+  }
+  // Consumed once, the next underflow must not see it again
+  lengths_[current_] = 0;
+
+  char* data = buffers_[current_].data();
+  setg(data, data, data + length);
+  return traits_type::to_int_type(*gptr());
+}
+
+// ====================================================================================================================
+
+IoUringWriteBuffer::IoUringWriteBuffer(size_t buffer_size)
+    : fd_(-1),
+      buffer_size_(buffer_size),
+      fixed_buffers_(false),
+      pending_{false, false},
+      offsets_{0, 0},
+      lengths_{0, 0},
+      current_(0),
+      file_offset_(0),
+      failed_(false) {}
+
+IoUringWriteBuffer::~IoUringWriteBuffer() { Close(); }
+
+int IoUringWriteBuffer::Open(const std::string& path) {
+  if (fd_ >= 0) {
+    Close();
+  }
+
+  if (engine_.Initialize(kFileRingEntries) != 0) {
+    return -1;
+  }
+
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    LOG(ERROR) << "[IoUringWriteBuffer] Failed to open " << path << ": " << strerror(errno);
+    engine_.Close();
+    return -1;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    buffers_[i].resize(buffer_size_);
+    pending_[i] = false;
+  }
+  fixed_buffers_ = RegisterFileBuffers(&engine_, buffers_);
+  current_ = 0;
+  file_offset_ = 0;
+  failed_ = false;
+  setp(buffers_[0].data(), buffers_[0].data() + buffer_size_);
+  return 0;
+}
+
+int IoUringWriteBuffer::Close() {
+  if (fd_ < 0) {
+    return failed_ ? -1 : 0;
+  }
+  SubmitCurrent();
+  for (int i = 0; i < 2; i++) {
+    WaitForWrite(i);
+  }
+  close(fd_);
+  fd_ = -1;
+  engine_.Close();
+  setp(nullptr, nullptr);
+  return failed_ ? -1 : 0;
+}
+
+void IoUringWriteBuffer::SubmitCurrent() {
+  size_t length = static_cast<size_t>(pptr() - pbase());
+  if (length == 0) {
+    return;
+  }
+
+  struct io_uring_sqe* sqe = engine_.GetSqe();
+  if (sqe == nullptr) {
+    // Cannot happen with two buffers, but never drop data
+    WaitForWrite(current_ ^ 1);
+    sqe = engine_.GetSqe();
+  }
+  sqe->opcode = fixed_buffers_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+  sqe->fd = fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(pbase());
+  sqe->len = static_cast<uint32_t>(length);
+  sqe->off = file_offset_;
+  sqe->buf_index = static_cast<uint16_t>(current_);
+  sqe->user_data = static_cast<uint64_t>(current_);
+  offsets_[current_] = file_offset_;
+  lengths_[current_] = static_cast<uint32_t>(length);
+  pending_[current_] = true;
+  file_offset_ += length;
+  engine_.Submit();
+
+  // Continue in the other buffer once its previous write has landed
+  current_ ^= 1;
+  WaitForWrite(current_);
+  char* data = buffers_[current_].data();
+  setp(data, data + buffer_size_);
+}
+
+void IoUringWriteBuffer::WaitForWrite(int index) {
+  while (pending_[index]) {
+    if (engine_.Submit(1) < 0) {
+      LOG(ERROR) << "[IoUringWriteBuffer] io_uring_enter failed";
+      pending_[index] = false;
+      failed_ = true;
+      return;
+    }
+    struct io_uring_cqe cqe;
+    while (engine_.PopCompletion(&cqe)) {
+      int completed = static_cast<int>(cqe.user_data);
+      pending_[completed] = false;
+      if (cqe.res < 0) {
+        LOG(ERROR) << "[IoUringWriteBuffer] Write failed: " << strerror(-cqe.res);
+        failed_ = true;
+        continue;
+      }
+      // Finish a short write synchronously, it only happens on errors such
+      // as a full disk
+      uint32_t written = static_cast<uint32_t>(cqe.res);
+      if (written < lengths_[completed]) {
+        ssize_t ret = pwrite(fd_, buffers_[completed].data() + written,
+                             lengths_[completed] - written,
+                             static_cast<off_t>(offsets_[completed] + written));
+        if (ret < 0 || static_cast<uint32_t>(ret) != lengths_[completed] - written) {
+          LOG(ERROR) << "[IoUringWriteBuffer] Short write";
+          failed_ = true;
+        }
+      }
+    }
+  }
+}
+
+IoUringWriteBuffer::int_type IoUringWriteBuffer::overflow(int_type ch) {
+  if (fd_ < 0 || failed_) {
+    return traits_type::eof();
+  }
+  SubmitCurrent();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+int IoUringWriteBuffer::sync() {
+  if (fd_ < 0) {
+    return -1;
+  }
+  SubmitCurrent();
+  return failed_ ? -1 : 0;
+}
+
+#endif  // HAVE_IO_URING
@@ -0,0 +1,107 @@
+#ifndef TOOLS_IO_URING_FILE_H
+#define TOOLS_IO_URING_FILE_H
+
+#include "tools/io_uring_engine.h"
+
+#ifdef HAVE_IO_URING
+
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Stream buffers doing file I/O through io_uring, so std::istream /
+// std::ostream based readers and writers (readYuvPlane, writeYUVToFile)
+// overlap disk I/O with processing without changing their code.
+// Both use two registered buffers: one is filled (or drained) by the kernel
+// while the caller works on the other. Regular files only.
+
+// Sequential reader with read-ahead of the next buffer
+class IoUringReadBuffer : public std::streambuf {
+ public:
+  explicit IoUringReadBuffer(size_t buffer_size = 1 << 20);
+  ~IoUringReadBuffer() override;
+
+  // Open a file and start reading ahead
+  // Returns 0 on success, negative value on error (caller should fall back
+  // to std::filebuf)
+  int Open(const std::string& path);
+
+  // Close the file, waiting for outstanding reads
+  void Close();
+
+  bool IsOpen() const { return fd_ >= 0; }
+
+  // Get ring statistics (syscall counts)
+  const IoUringEngine::Stats& GetStats() const { return engine_.GetStats(); }
+
+ protected:
+  int_type underflow() override;
+
+ private:
+  // Queue a read of the next file chunk into buffer index
+  void SubmitRead(int index);
+
+  // Wait until the read into buffer index has completed
+  void WaitForRead(int index);
+
+  IoUringEngine engine_;
+  int fd_;
+  size_t buffer_size_;
+  bool fixed_buffers_;
+  std::vector<char> buffers_[2];
+  bool pending_[2];
+  int32_t lengths_[2];
+  int current_;
+  uint64_t file_offset_;
+  bool eof_submitted_;
+};
+
+// Sequential writer; sync() (flush) queues the buffered data and returns
+// without waiting for the write to complete
+class IoUringWriteBuffer : public std::streambuf {
+ public:
+  explicit IoUringWriteBuffer(size_t buffer_size = 1 << 20);
+  ~IoUringWriteBuffer() override;
+
+  // Create or truncate a file for writing
+  // Returns 0 on success, negative value on error (caller should fall back
+  // to std::filebuf)
+  int Open(const std::string& path);
+
+  // Write out buffered data, wait for all writes and close the file
+  // Returns 0 on success, negative value if any write failed
+  int Close();
+
+  bool IsOpen() const { return fd_ >= 0; }
+
+  // Get ring statistics (syscall counts)
+  const IoUringEngine::Stats& GetStats() const { return engine_.GetStats(); }
+
+ protected:
+  int_type overflow(int_type ch) override;
+  int sync() override;
+
+ private:
+  // Queue the filled part of the current buffer and switch to the other one
+  void SubmitCurrent();
+
+  // Wait until the write from buffer index has completed
+  void WaitForWrite(int index);
+
+  IoUringEngine engine_;
+  int fd_;
+  size_t buffer_size_;
+  bool fixed_buffers_;
+  std::vector<char> buffers_[2];
+  bool pending_[2];
+  uint64_t offsets_[2];
+  uint32_t lengths_[2];
+  int current_;
+  uint64_t file_offset_;
+  bool failed_;
+};
+
+#endif  // HAVE_IO_URING
+
+#endif  // TOOLS_IO_URING_FILE_H
@@ -0,0 +1,263 @@
+#include "pixel_convert.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+// ====================================================================================================================
+// Scalar reference versions
+
+static void WidenRow8To16Scalar(const uint8_t* src, int16_t* dst, size_t n, int shift) {
+  for (size_t x = 0; x < n; x++) {
+    dst[x] = static_cast<int16_t>(src[x] << shift);
+  }
+}
+
+static void NarrowRow16To8Scalar(const uint16_t* src, uint8_t* dst, size_t n, int shift) {
+  for (size_t x = 0; x < n; x++) {
+    dst[x] = static_cast<uint8_t>(src[x] >> shift);
+  }
+}
+
+static size_t PackRow10Scalar(const uint16_t* src, uint8_t* dst, size_t n) {
+  uint8_t* out = dst;
+  for (size_t x = 0; x < n; x += 4) {
+    // 4 values (8 bytes) into 5 bytes
+    int64_t temp = (static_cast<int64_t>(src[x + 0]) << 0) +
+                   (static_cast<int64_t>(src[x + 1]) << 10) +
+                   (static_cast<int64_t>(src[x + 2]) << 20) +
+                   (static_cast<int64_t>(src[x + 3]) << 30);
+    out[0] = (temp >> 0) & 0xff;
+    out[1] = (temp >> 8) & 0xff;
+    out[2] = (temp >> 16) & 0xff;
+    out[3] = (temp >> 24) & 0xff;
+    out[4] = (temp >> 32) & 0xff;
+    out += 5;
+  }
+  return static_cast<size_t>(out - dst);
+}
+
+// ====================================================================================================================
+// x86 versions; the main loops handle whole vectors and leave the tail to
+// the scalar code
+
+#ifdef PIXEL_CONVERT_X86
+
+static void WidenRow8To16Sse2(const uint8_t* src, int16_t* dst, size_t n, int shift) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  size_t x = 0;
+  for (; x + 16 <= n; x += 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+    __m128i lo = _mm_sll_epi16(_mm_unpacklo_epi8(in, zero), count);
+    __m128i hi = _mm_sll_epi16(_mm_unpackhi_epi8(in, zero), count);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x + 8), hi);
+  }
+  WidenRow8To16Scalar(src + x, dst + x, n - x, shift);
+}
+
+static void NarrowRow16To8Sse2(const uint16_t* src, uint8_t* dst, size_t n, int shift) {
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  // Mask before packing so out of range values truncate like the scalar cast
+  const __m128i low_byte = _mm_set1_epi16(0xff);
+  size_t x = 0;
+  for (; x + 16 <= n; x += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x + 8));
+    a = _mm_and_si128(_mm_srl_epi16(a, count), low_byte);
+    b = _mm_and_si128(_mm_srl_epi16(b, count), low_byte);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(a, b));
+  }
+  NarrowRow16To8Scalar(src + x, dst + x, n - x, shift);
+}
+
+// Combine 8 samples into two 40-bit groups, one per 64-bit lane
+static inline __m128i PackGroups10(__m128i samples) {
+  // s0 + s1 * 1024 per 32-bit lane, exact for 10-bit samples
+  __m128i pairs = _mm_madd_epi16(samples, _mm_set1_epi32(1024 << 16 | 1));
+  // a0 | a1 << 20 per 64-bit lane
+  __m128i low = _mm_and_si128(pairs, _mm_set_epi32(0, -1, 0, -1));
+  __m128i high = _mm_slli_epi64(_mm_srli_epi64(pairs, 32), 20);
+  return _mm_or_si128(low, high);
+}
+
+// Store the two 5-byte groups of PackGroups10 as 10 contiguous bytes
+static inline void StoreGroups10(__m128i groups, uint8_t* dst) {
+  __m128i second = _mm_srli_si128(groups, 8);
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(dst),
+                   _mm_or_si128(groups, _mm_slli_epi64(second, 40)));
+  uint16_t tail = static_cast<uint16_t>(_mm_cvtsi128_si32(_mm_srli_epi64(second, 24)));
+  std::memcpy(dst + 8, &tail, sizeof(tail));
+}
+
+static size_t PackRow10Sse2(const uint16_t* src, uint8_t* dst, size_t n) {
+  size_t x = 0;
+  uint8_t* out = dst;
+  for (; x + 8 <= n; x += 8) {
+    __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+    StoreGroups10(PackGroups10(samples), out);
+    out += 10;
+  }
+  if (x < n) {
+    out += PackRow10Scalar(src + x, out, n - x);
+  }
+  return static_cast<size_t>(out - dst);
+}
+
+__attribute__((target("avx2")))
+static void WidenRow8To16Avx2(const uint8_t* src, int16_t* dst, size_t n, int shift) {
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  size_t x = 0;
+  for (; x + 32 <= n; x += 32) {
+    __m256i lo = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x)));
+    __m256i hi = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x + 16)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_sll_epi16(lo, count));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x + 16), _mm256_sll_epi16(hi, count));
+  }
+  // The tails run legacy SSE code, leave the upper halves clean for it
+  _mm256_zeroupper();
+  WidenRow8To16Sse2(src + x, dst + x, n - x, shift);
+}
+
+__attribute__((target("avx2")))
+static void NarrowRow16To8Avx2(const uint16_t* src, uint8_t* dst, size_t n, int shift) {
+  const __m128i count = _mm_cvtsi32_si128(shift);
+  const __m256i low_byte = _mm256_set1_epi16(0xff);
+  size_t x = 0;
+  for (; x + 32 <= n; x += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x + 16));
+    a = _mm256_and_si256(_mm256_srl_epi16(a, count), low_byte);
+    b = _mm256_and_si256(_mm256_srl_epi16(b, count), low_byte);
+    // packus works per 128-bit lane, restore sample order afterwards
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), packed);
+  }
+  _mm256_zeroupper();
+  NarrowRow16To8Sse2(src + x, dst + x, n - x, shift);
+}
+
+__attribute__((target("avx2")))
+static size_t PackRow10Avx2(const uint16_t* src, uint8_t* dst, size_t n) {
+  const __m256i weights = _mm256_set1_epi32(1024 << 16 | 1);
+  const __m256i low_mask = _mm256_set1_epi64x(0xffffffff);
+  size_t x = 0;
+  uint8_t* out = dst;
+  for (; x + 16 <= n; x += 16) {
+    __m256i samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+    __m256i pairs = _mm256_madd_epi16(samples, weights);
+    __m256i groups = _mm256_or_si256(
+        _mm256_and_si256(pairs, low_mask),
+        _mm256_slli_epi64(_mm256_srli_epi64(pairs, 32), 20));
+    StoreGroups10(_mm256_castsi256_si128(groups), out);
+    StoreGroups10(_mm256_extracti128_si256(groups, 1), out + 10);
+    out += 20;
+  }
+  _mm256_zeroupper();
+  if (x < n) {
+    out += PackRow10Sse2(src + x, out, n - x);
+  }
+  return static_cast<size_t>(out - dst);
+}
+
+#endif  // PIXEL_CONVERT_X86
+
+// ====================================================================================================================
+// Dispatch
+
+struct PixelKernels {
+  void (*widen_8_to_16)(const uint8_t*, int16_t*, size_t, int);
+  void (*narrow_16_to_8)(const uint16_t*, uint8_t*, size_t, int);
+  size_t (*pack_10)(const uint16_t*, uint8_t*, size_t);
+};
+
+static const PixelKernels kScalarKernels = {
+    WidenRow8To16Scalar, NarrowRow16To8Scalar, PackRow10Scalar};
+#ifdef PIXEL_CONVERT_X86
+static const PixelKernels kSse2Kernels = {
+    WidenRow8To16Sse2, NarrowRow16To8Sse2, PackRow10Sse2};
+static const PixelKernels kAvx2Kernels = {
+    WidenRow8To16Avx2, NarrowRow16To8Avx2, PackRow10Avx2};
+#endif
+
+static SimdLevel DetectSimdLevel() {
+#ifdef PIXEL_CONVERT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SimdLevel::kSse2;
+  }
+#endif
+  return SimdLevel::kScalar;
+}
+
+static const PixelKernels* KernelsFor(SimdLevel level) {
+  switch (level) {
+#ifdef PIXEL_CONVERT_X86
+    case SimdLevel::kAvx2:
+      return &kAvx2Kernels;
+    case SimdLevel::kSse2:
+      return &kSse2Kernels;
+#endif
+    default:
+      return &kScalarKernels;
+  }
+}
+
+static SimdLevel BestSimdLevel() {
+  static const SimdLevel best = DetectSimdLevel();
+  return best;
+}
+
+// Selected on first use, so conversions from static initializers work too
+static SimdLevel& ActiveSimdLevel() {
+  static SimdLevel level = BestSimdLevel();
+  return level;
+}
+
+static const PixelKernels*& ActiveKernels() {
+  static const PixelKernels* kernels = KernelsFor(ActiveSimdLevel());
+  return kernels;
+}
+
+SimdLevel GetSimdLevel() { return ActiveSimdLevel(); }
+
+SimdLevel SetSimdLevel(SimdLevel level) {
+  if (static_cast<int>(level) > static_cast<int>(BestSimdLevel())) {
+    level = BestSimdLevel();
+  }
+  ActiveSimdLevel() = level;
+  ActiveKernels() = KernelsFor(level);
+  return level;
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kAvx2:
+      return "avx2";
+    case SimdLevel::kSse2:
+      return "sse2";
+    default:
+      return "scalar";
+  }
+}
+
+void WidenRow8To16(const uint8_t* src, int16_t* dst, size_t n, int shift) {
+  ActiveKernels()->widen_8_to_16(src, dst, n, shift);
+}
+
+void NarrowRow16To8(const uint16_t* src, uint8_t* dst, size_t n, int shift) {
+  ActiveKernels()->narrow_16_to_8(src, dst, n, shift);
+}
+
+size_t PackRow10(const uint16_t* src, uint8_t* dst, size_t n) {
+  return ActiveKernels()->pack_10(src, dst, n);
+}
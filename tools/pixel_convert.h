@@ -0,0 +1,43 @@
+#ifndef TOOLS_PIXEL_CONVERT_H
+#define TOOLS_PIXEL_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Row kernels for the sample format conversions done when reading YUV
+// input into vvenc buffers and writing vvdec output. Each kernel has a
+// scalar version and, on x86, SSE2 and AVX2 versions picked at runtime from
+// the CPU's capabilities; all produce bit-identical output.
+
+enum class SimdLevel {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+// Level the kernels currently dispatch to (the best one the CPU supports,
+// unless lowered with SetSimdLevel)
+SimdLevel GetSimdLevel();
+
+// Force a dispatch level (clamped to what the CPU supports), e.g. to
+// compare implementations. Not thread safe against concurrent conversions
+// Returns the level actually selected
+SimdLevel SetSimdLevel(SimdLevel level);
+
+// Name of a level for logs ("scalar", "sse2", "avx2")
+const char* GetSimdLevelName(SimdLevel level);
+
+// dst[x] = src[x] << shift for n 8-bit samples
+void WidenRow8To16(const uint8_t* src, int16_t* dst, size_t n, int shift = 0);
+
+// dst[x] = (uint8_t)(src[x] >> shift) for n 16-bit samples (the result is
+// truncated to 8 bits, not saturated)
+void NarrowRow16To8(const uint16_t* src, uint8_t* dst, size_t n, int shift);
+
+// Pack 10-bit samples, 4 per 5 bytes (little-endian bit order), as in
+// packed YUV output. Samples must fit in 10 bits. Reads and packs
+// (n + 3) / 4 * 4 samples
+// Returns the number of bytes written
+size_t PackRow10(const uint16_t* src, uint8_t* dst, size_t n);
+
+#endif  // TOOLS_PIXEL_CONVERT_H
@@ -0,0 +1,240 @@
+#ifndef TOOLS_SPSC_QUEUE_H
+#define TOOLS_SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Bounded single-producer/single-consumer ring buffer for handing items
+// between pipeline stages (receive -> decode -> write, capture -> encode).
+// Exactly one thread may push and one thread may pop. The non-blocking
+// Try* calls never take a lock or make a syscall. The blocking Push/Pop
+// wait with std::atomic::wait (a futex on Linux), and the other side only
+// calls notify when a waiter announced itself, so a busy pipeline pays no
+// wakeup cost. PopUntil, which std::atomic::wait cannot time out, sleeps on
+// a condition variable instead.
+// The producer index, the consumer index and the wait state sit on separate
+// cache lines, and each side keeps a cached copy of the other side's index
+// that it only rereads when the cached value says full (or empty), so the
+// two cores do not bounce a shared line on every item.
+template <typename T>
+class SpscQueue {
+ public:
+  // capacity is rounded up to a power of two
+  explicit SpscQueue(size_t capacity)
+      : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+        slots_(std::make_unique<T[]>(mask_ + 1)) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // Producer: append an item if there is room
+  // Returns false if the queue is full
+  bool TryPush(T item) { return TryMoveIn(item); }
+
+  // Consumer: take the oldest item if there is one
+  // Returns false if the queue is empty
+  bool TryPop(T* item) {
+    uint32_t head = consumer_.index.load(std::memory_order_relaxed);
+    if (head == consumer_.cached_other) {
+      consumer_.cached_other = producer_.index.load(std::memory_order_acquire);
+      if (head == consumer_.cached_other) {
+        return false;
+      }
+    }
+    *item = std::move(slots_[head & mask_]);
+    consumer_.index.store(head + 1, std::memory_order_release);
+    Wake(&producer_waiter_);
+    return true;
+  }
+
+  // Producer: append an item, waiting while the queue is full
+  // Returns false (dropping the item) if the queue was closed
+  bool Push(T item) {
+    while (!closed_.load(std::memory_order_acquire)) {
+      uint32_t epoch = producer_waiter_.epoch.load(std::memory_order_acquire);
+      if (TryMoveIn(item)) {
+        return true;
+      }
+      Wait(&producer_waiter_, epoch, [this] { return !IsFull(); });
+    }
+    return false;
+  }
+
+  // Consumer: take the oldest item, waiting while the queue is empty
+  // Returns false once the queue is closed and drained
+  bool Pop(T* item) {
+    for (;;) {
+      uint32_t epoch = consumer_waiter_.epoch.load(std::memory_order_acquire);
+      if (TryPop(item)) {
+        return true;
+      }
+      if (closed_.load(std::memory_order_acquire)) {
+        // Items pushed before Close are still delivered
+        return TryPop(item);
+      }
+      Wait(&consumer_waiter_, epoch, [this] { return !IsEmpty(); });
+    }
+  }
+
+  // Consumer: like Pop, but give up at deadline
+  // Returns false if the queue is still empty at deadline, or once it is
+  // closed and drained
+  bool PopUntil(T* item, std::chrono::steady_clock::time_point deadline) {
+    for (;;) {
+      uint32_t epoch = consumer_waiter_.epoch.load(std::memory_order_acquire);
+      if (TryPop(item)) {
+        return true;
+      }
+      if (closed_.load(std::memory_order_acquire)) {
+        return TryPop(item);
+      }
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+      WaitUntil(&consumer_waiter_, epoch, deadline, [this] { return !IsEmpty(); });
+    }
+  }
+
+  // End the stream: wakes both sides, Push fails from now on and Pop fails
+  // once the remaining items are consumed. Callable from any thread.
+  void Close() {
+    closed_.store(true, std::memory_order_release);
+    for (Waiter* waiter : {&producer_waiter_, &consumer_waiter_}) {
+      {
+        std::lock_guard<std::mutex> lock(waiter->timed.mutex);
+        waiter->epoch.fetch_add(1, std::memory_order_release);
+      }
+      waiter->epoch.notify_all();
+      waiter->timed.wakeup.notify_all();
+    }
+  }
+
+  bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Approximate item count (exact when called from either end with the
+  // other side idle)
+  size_t Size() const {
+    return producer_.index.load(std::memory_order_acquire) -
+           consumer_.index.load(std::memory_order_acquire);
+  }
+
+  bool IsEmpty() const { return Size() == 0; }
+  bool IsFull() const { return Size() == Capacity(); }
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  // Assumed cache line size (x86-64 and most ARM64 cores)
+  static constexpr size_t kCacheLineSize = 64;
+
+  // Index owned by one end, padded to its own cache line
+  struct alignas(kCacheLineSize) Side {
+    std::atomic<uint32_t> index{0};  // Next slot to write (producer) or read (consumer)
+    uint32_t cached_other = 0;       // Last seen index of the other side
+  };
+
+  // How an end announced that it is blocked
+  enum WaitKind : uint32_t { kNotWaiting, kAtomicWait, kTimedWait };
+
+  // Blocking state of one end; only written around a wait, so reading it
+  // after every item does not contend
+  struct alignas(kCacheLineSize) Waiter {
+    std::atomic<uint32_t> epoch{0};              // Bumped to wake this end
+    std::atomic<uint32_t> waiting{kNotWaiting};  // WaitKind of a blocked end
+    // Sleep of a timed wait, kept off the line the other end reads
+    struct alignas(kCacheLineSize) {
+      std::mutex mutex;                      // Orders bumps with WaitUntil
+      std::condition_variable wakeup;
+    } timed;
+  };
+
+  // Move item into the queue only if there is room, so a failed attempt
+  // leaves it with the caller
+  bool TryMoveIn(T& item) {
+    uint32_t tail = producer_.index.load(std::memory_order_relaxed);
+    if (tail - producer_.cached_other == mask_ + 1) {
+      producer_.cached_other = consumer_.index.load(std::memory_order_acquire);
+      if (tail - producer_.cached_other == mask_ + 1) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(item);
+    producer_.index.store(tail + 1, std::memory_order_release);
+    Wake(&consumer_waiter_);
+    return true;
+  }
+
+  static uint32_t RoundUpToPowerOfTwo(size_t value) {
+    uint32_t capacity = 1;
+    while (capacity < value) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  // Wake an end if it announced that it is waiting; clearing the flag
+  // means a burst of items costs one notify rather than one per item
+  // The fence pairs with the one in Wait: either the waiter sees the new
+  // index, or we see its waiting flag
+  static void Wake(Waiter* waiter) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiter->waiting.load(std::memory_order_relaxed) == kNotWaiting) {
+      return;
+    }
+    uint32_t kind = waiter->waiting.exchange(kNotWaiting, std::memory_order_relaxed);
+    if (kind == kAtomicWait) {
+      waiter->epoch.fetch_add(1, std::memory_order_release);
+      waiter->epoch.notify_one();
+    } else if (kind == kTimedWait) {
+      {
+        std::lock_guard<std::mutex> lock(waiter->timed.mutex);
+        waiter->epoch.fetch_add(1, std::memory_order_release);
+      }
+      waiter->timed.wakeup.notify_one();
+    }
+  }
+
+  // Block until ready() holds, the queue is closed, or epoch has moved on
+  template <typename Ready>
+  void Wait(Waiter* waiter, uint32_t epoch, Ready ready) {
+    waiter->waiting.store(kAtomicWait, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready() && !closed_.load(std::memory_order_acquire)) {
+      waiter->epoch.wait(epoch, std::memory_order_acquire);
+    }
+    waiter->waiting.store(kNotWaiting, std::memory_order_relaxed);
+  }
+
+  // Wait, but give up at deadline. The epoch is bumped under the mutex for
+  // a timed waiter, so the wakeup cannot slip in between the check and the
+  // sleep
+  template <typename Ready>
+  void WaitUntil(Waiter* waiter, uint32_t epoch,
+                 std::chrono::steady_clock::time_point deadline, Ready ready) {
+    waiter->waiting.store(kTimedWait, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready() && !closed_.load(std::memory_order_acquire)) {
+      std::unique_lock<std::mutex> lock(waiter->timed.mutex);
+      waiter->timed.wakeup.wait_until(lock, deadline, [waiter, epoch] {
+        return waiter->epoch.load(std::memory_order_acquire) != epoch;
+      });
+    }
+    waiter->waiting.store(kNotWaiting, std::memory_order_relaxed);
+  }
+
+  const uint32_t mask_;
+  std::unique_ptr<T[]> slots_;
+  Side producer_;
+  Side consumer_;
+  Waiter producer_waiter_;
+  Waiter consumer_waiter_;
+  alignas(kCacheLineSize) std::atomic<bool> closed_{false};
+};
+
+#endif  // TOOLS_SPSC_QUEUE_H
@@ -0,0 +1,71 @@
+#ifndef TOOLS_STAGE_STATS_H
+#define TOOLS_STAGE_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Counters of one pipeline stage, kept by the thread consuming its input
+// queue: how deep the queue was when an item was taken, how long items sat
+// in it, and how the stage's time splits between waiting for work (idle)
+// and processing (busy). Single writer; read once the stage has stopped.
+class StageStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Record an item taken from the queue with depth items still queued
+  // behind it, after it was queued at queued_at
+  void RecordItem(size_t depth, Clock::time_point queued_at, Clock::time_point now) {
+    int64_t queued_ns = ToNs(now - queued_at);
+    items_++;
+    depth_sum_ += depth;
+    max_depth_ = std::max(max_depth_, depth);
+    queued_ns_ += queued_ns;
+    max_queued_ns_ = std::max(max_queued_ns_, queued_ns);
+  }
+
+  // Time spent blocked waiting for the next item
+  void RecordIdle(Clock::duration idle) { idle_ns_ += ToNs(idle); }
+
+  // Time spent processing an item
+  void RecordBusy(Clock::duration busy) { busy_ns_ += ToNs(busy); }
+
+  // Items dropped instead of queued. The producer counts its drops and
+  // records them here once the stage has stopped
+  void RecordDropped(uint64_t count) { dropped_ += count; }
+
+  uint64_t GetItems() const { return items_; }
+
+  // One-line summary: items, queue depth (mean/max), queued time in ms
+  // (mean/max), idle/busy time in ms and dropped items
+  std::string ToString() const {
+    std::ostringstream oss;
+    oss << "items=" << items_ << " depth_avg="
+        << (items_ ? static_cast<double>(depth_sum_) / items_ : 0.0)
+        << " depth_max=" << max_depth_ << " queued_ms_avg="
+        << (items_ ? queued_ns_ / 1e6 / items_ : 0.0)
+        << " queued_ms_max=" << max_queued_ns_ / 1e6
+        << " idle_ms=" << idle_ns_ / 1000000 << " busy_ms=" << busy_ns_ / 1000000
+        << " dropped=" << dropped_;
+    return oss.str();
+  }
+
+ private:
+  static int64_t ToNs(Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  }
+
+  uint64_t items_ = 0;
+  uint64_t depth_sum_ = 0;
+  size_t max_depth_ = 0;
+  int64_t queued_ns_ = 0;
+  int64_t max_queued_ns_ = 0;
+  int64_t idle_ns_ = 0;
+  int64_t busy_ns_ = 0;
+  uint64_t dropped_ = 0;
+};
+
+#endif  // TOOLS_STAGE_STATS_H
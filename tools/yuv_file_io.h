@@ -2,8 +2,11 @@
 #define TOOLS_YUV_FILE_IO_H
 
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <regex>
 #include <sstream>
 #include <string>
@@ -12,22 +15,26 @@
 #include "vvenc/vvenc.h"
 #include "vvdec/vvdec.h"
 #include "log_system/log_system.h"
+#include "tools/io_uring_file.h"
+#include "tools/pixel_convert.h"
 
 struct vvencYUVBuffer;
 
 typedef int16_t LPel;
 
-static bool readYuvPlane(std::istream& fd, vvencYUVPlane& yuvPlane,
-                         const int& compID) {
-  // Assume 8-bit input YUV420 format (most common)
-  const bool is16bit = false;
-  const vvencChromaFormat inputChFmt = VVENC_CHROMA_420;
-  const vvencChromaFormat internChFmt = VVENC_CHROMA_420;
-  
+/// Read one plane of a raw YUV file into a vvenc plane, converting from the
+/// file's chroma format to the buffer's. Specialized per format so every
+/// combination gets its own loop without per-sample branches; readYuvPlane
+/// below picks the instantiation once per plane.
+/// is16bit: file samples are 16-bit little-endian (10-bit content)
+template <bool is16bit, vvencChromaFormat inputChFmt, vvencChromaFormat internChFmt>
+static bool readYuvPlaneT(std::istream& fd, vvencYUVPlane& yuvPlane,
+                          const int& compID) {
   const int csx_file = ((compID == 0) || (inputChFmt == VVENC_CHROMA_444)) ? 0 : 1;
   const int csy_file = ((compID == 0) || (inputChFmt != VVENC_CHROMA_420)) ? 0 : 1;
   const int csx_dest = ((compID == 0) || (internChFmt == VVENC_CHROMA_444)) ? 0 : 1;
   const int csy_dest = ((compID == 0) || (internChFmt != VVENC_CHROMA_420)) ? 0 : 1;
+  constexpr int bytesPerSample = is16bit ? 2 : 1;
 
   const int stride = yuvPlane.stride;
   const int width = yuvPlane.width;
@@ -35,7 +42,7 @@ static bool readYuvPlane(std::istream& fd, vvencYUVPlane& yuvPlane,
   LPel* dst = yuvPlane.ptr;
 
   // Calculate file stride accounting for bit depth
-  const int fileStride = ((width << csx_dest) * (is16bit ? 2 : 1)) >> csx_file;
+  const int fileStride = ((width << csx_dest) * bytesPerSample) >> csx_file;
   // const int fileHeight = ((height << csy_dest)) >> csy_file;
 
   std::vector<uint8_t> bufVec(fileStride);
@@ -54,27 +61,34 @@ static bool readYuvPlane(std::istream& fd, vvencYUVPlane& yuvPlane,
 
     if ((y444 & mask_y_dest) == 0) {
       // process current destination line
-      if (csx_file < csx_dest) {
+      if (csx_file == csx_dest) {
+        // same horizontal resolution, the common case for every plane
+        if constexpr (!is16bit) {
+          WidenRow8To16(buf, dst, width);
+        } else if constexpr (std::endian::native == std::endian::little) {
+          std::memcpy(dst, buf, width * sizeof(LPel));
+        } else {
+          for (int x = 0; x < width; x++) {
+            dst[x] = LPel(buf[x * 2 + 0]) | (LPel(buf[x * 2 + 1]) << 8);
+          }
+        }
+      } else if (csx_file < csx_dest) {
         // eg file is 444, dest is 422.
         const int sx = csx_dest - csx_file;
-        if (!is16bit) {
-          for (int x = 0; x < width; x++) {
+        for (int x = 0; x < width; x++) {
+          if constexpr (!is16bit) {
             dst[x] = buf[x << sx];
-          }
-        } else {
-          for (int x = 0; x < width; x++) {
+          } else {
             dst[x] = LPel(buf[(x << sx) * 2 + 0]) | (LPel(buf[(x << sx) * 2 + 1]) << 8);
           }
         }
       } else {
         // eg file is 422, dest is 444.
         const int sx = csx_file - csx_dest;
-        if (!is16bit) {
-          for (int x = 0; x < width; x++) {
+        for (int x = 0; x < width; x++) {
+          if constexpr (!is16bit) {
             dst[x] = buf[x >> sx];
-          }
-        } else {
-          for (int x = 0; x < width; x++) {
+          } else {
             dst[x] = LPel(buf[(x >> sx) * 2 + 0]) | (LPel(buf[(x >> sx) * 2 + 1]) << 8);
           }
         }
@@ -86,15 +100,82 @@ static bool readYuvPlane(std::istream& fd, vvencYUVPlane& yuvPlane,
   return true;
 }
 
+template <bool is16bit, vvencChromaFormat inputChFmt>
+static bool readYuvPlaneForInput(std::istream& fd, vvencYUVPlane& yuvPlane,
+                                 const int& compID, vvencChromaFormat internChFmt) {
+  switch (internChFmt) {
+    case VVENC_CHROMA_422:
+      return readYuvPlaneT<is16bit, inputChFmt, VVENC_CHROMA_422>(fd, yuvPlane, compID);
+    case VVENC_CHROMA_444:
+      return readYuvPlaneT<is16bit, inputChFmt, VVENC_CHROMA_444>(fd, yuvPlane, compID);
+    default:
+      return readYuvPlaneT<is16bit, inputChFmt, VVENC_CHROMA_420>(fd, yuvPlane, compID);
+  }
+}
+
+/// Read one plane of a file with fileBitDepth-bit samples (8, or up to 16
+/// stored in 2 bytes) in inputChFmt into a buffer allocated for internChFmt
+static bool readYuvPlane(std::istream& fd, vvencYUVPlane& yuvPlane,
+                         const int& compID, int fileBitDepth = 8,
+                         vvencChromaFormat inputChFmt = VVENC_CHROMA_420,
+                         vvencChromaFormat internChFmt = VVENC_CHROMA_420) {
+  if (fileBitDepth > 8) {
+    switch (inputChFmt) {
+      case VVENC_CHROMA_422:
+        return readYuvPlaneForInput<true, VVENC_CHROMA_422>(fd, yuvPlane, compID, internChFmt);
+      case VVENC_CHROMA_444:
+        return readYuvPlaneForInput<true, VVENC_CHROMA_444>(fd, yuvPlane, compID, internChFmt);
+      default:
+        return readYuvPlaneForInput<true, VVENC_CHROMA_420>(fd, yuvPlane, compID, internChFmt);
+    }
+  }
+  switch (inputChFmt) {
+    case VVENC_CHROMA_422:
+      return readYuvPlaneForInput<false, VVENC_CHROMA_422>(fd, yuvPlane, compID, internChFmt);
+    case VVENC_CHROMA_444:
+      return readYuvPlaneForInput<false, VVENC_CHROMA_444>(fd, yuvPlane, compID, internChFmt);
+    default:
+      return readYuvPlaneForInput<false, VVENC_CHROMA_420>(fd, yuvPlane, compID, internChFmt);
+  }
+}
+
 // ====================================================================================================================
 
 class YuvFileIO {
  private:
   std::string m_lastError;  ///< temporal storage for last occured error
   std::fstream m_cHandle;   ///< file handle
+#ifdef HAVE_IO_URING
+  std::unique_ptr<IoUringReadBuffer> m_uringBuf;  ///< io_uring read-ahead buffer
+#endif
+  std::istream m_uringStream{nullptr};  ///< stream over m_uringBuf
+  std::istream* m_stream = &m_cHandle;  ///< stream the planes are read from
+  int m_fileBitDepth = 8;  ///< bit depth of the file samples
+  vvencChromaFormat m_fileChFmt = VVENC_CHROMA_420;    ///< chroma format of the file
+  vvencChromaFormat m_internChFmt = VVENC_CHROMA_420;  ///< chroma format of the buffers
 
  public:
-  int open(const std::string& fileName) {
+  /// useIoUring reads the file through io_uring with read-ahead, falling
+  /// back to a blocking std::fstream when io_uring is unavailable
+  int open(const std::string& fileName, bool useIoUring = false) {
+#ifdef HAVE_IO_URING
+    if (useIoUring && IoUringEngine::IsSupported()) {
+      m_uringBuf = std::make_unique<IoUringReadBuffer>();
+      if (m_uringBuf->Open(fileName) == 0) {
+        m_uringStream.rdbuf(m_uringBuf.get());
+        m_uringStream.clear();
+        m_stream = &m_uringStream;
+        return 0;
+      }
+      m_uringBuf.reset();
+      LOG(WARNING) << "[YuvFileIO] io_uring unavailable, using blocking reads";
+    }
+#else
+    if (useIoUring) {
+      LOG(WARNING) << "[YuvFileIO] io_uring not available on this platform";
+    }
+#endif
+    m_stream = &m_cHandle;
     m_cHandle.open(fileName.c_str(), std::ios::binary | std::ios::in);
 
     if (m_cHandle.fail()) {
@@ -104,10 +185,36 @@ class YuvFileIO {
     return 0;
   }
 
-  void close() { m_cHandle.close(); }
-  bool isOpen() { return m_cHandle.is_open(); }
-  bool isEof() { return m_cHandle.eof(); }
-  bool isFail() { return m_cHandle.fail(); }
+  /// Sample format of the file and of the buffers passed to readYuvBuf.
+  /// Files deeper than 8 bits hold 2-byte little-endian samples
+  void setFormat(int fileBitDepth, vvencChromaFormat fileChFmt,
+                 vvencChromaFormat internChFmt) {
+    m_fileBitDepth = fileBitDepth;
+    m_fileChFmt = fileChFmt;
+    m_internChFmt = internChFmt;
+  }
+
+  void close() {
+#ifdef HAVE_IO_URING
+    if (m_uringBuf) {
+      m_uringStream.rdbuf(nullptr);
+      m_uringBuf.reset();
+      m_stream = &m_cHandle;
+      return;
+    }
+#endif
+    m_cHandle.close();
+  }
+  bool isOpen() {
+#ifdef HAVE_IO_URING
+    if (m_uringBuf) {
+      return m_uringBuf->IsOpen();
+    }
+#endif
+    return m_cHandle.is_open();
+  }
+  bool isEof() { return m_stream->eof(); }
+  bool isFail() { return m_stream->fail(); }
   std::string getLastError() const { return m_lastError; }
 
   int readYuvBuf(vvencYUVBuffer& yuvInBuf, bool& bEof) {
@@ -119,12 +226,13 @@ class YuvFileIO {
       return 0;
     }
 
-    const int numComp = 3;  // yuv420
+    const int numComp = 3;
 
     for (int comp = 0; comp < numComp; comp++) {
       vvencYUVPlane yuvPlane = yuvInBuf.planes[comp];
 
-      if (!readYuvPlane(m_cHandle, yuvPlane, comp)) {
+      if (!readYuvPlane(*m_stream, yuvPlane, comp, m_fileBitDepth, m_fileChFmt,
+                        m_internChFmt)) {
         m_lastError = "error reading YUV plane data: " + std::to_string(comp);
         bEof = true;
         LOG(VERBOSE) << "[YuvFileIO::readYuvBuf] Reached end of file or read "
@@ -370,77 +478,37 @@ static int _writeComponentToFile( std::ostream *f, vvdecPlane *plane, vvdecPlane
 
   if( plane->bytesPerSample == 2 )
   {
-     unsigned short* p  = reinterpret_cast<unsigned short*>( plane->ptr );
-     unsigned short* p2  = planeField2 ? reinterpret_cast<unsigned short*>( planeField2->ptr ) : nullptr;
-
      if( uiBytesPerSample == 1 )  // cut to 8bit output
      {
-       // 8bit > 16bit conversion
-       std::vector<unsigned char> tmp;
-       std::vector<unsigned char> tmp2;
-       tmp.resize(uiWidth);
-       if( planeField2 )
-       {
-         tmp2.resize(uiWidth);
-       }
+       // 16bit > 8bit conversion
+       std::vector<unsigned char> tmp( uiWidth );
 
        for( uint32_t y = 0; y < uiHeight; y++ )
        {
-         for( uint32_t x = 0; x < uiWidth; x++ )
-         {
-           tmp[x] = (unsigned char)(p[x]>>2);
-         }
-         f->write( (char*)&tmp[0], sizeof(std::vector<unsigned char>::value_type)*tmp.size());
-         p += plane->stride;
+         NarrowRow16To8( reinterpret_cast<const uint16_t*>( plane->ptr + y * plane->stride ), &tmp[0], uiWidth, 2 );
+         f->write( (char*)&tmp[0], uiWidth );
 
-         if( p2 )
+         if( planeField2 )
          {
-           for( uint32_t x = 0; x < uiWidth; x++ )
-           {
-             tmp2[x] = (unsigned char)(p2[x]>>2);
-           }
-           f->write( (char*)&tmp2[0], sizeof(std::vector<unsigned char>::value_type)*tmp2.size());
-           p2 += planeField2->stride;
+           NarrowRow16To8( reinterpret_cast<const uint16_t*>( planeField2->ptr + y * planeField2->stride ), &tmp[0], uiWidth, 2 );
+           f->write( (char*)&tmp[0], uiWidth );
          }
        }
      }
      else if( writePYUV)
      {
-       unsigned short* p  = reinterpret_cast<unsigned short*>( plane->ptr );
-       unsigned short* p2 = reinterpret_cast<unsigned short*>( planeField2 ? planeField2->ptr : nullptr );
-
-       std::vector<unsigned char> bufVec(5);
-       unsigned char *buf=&(bufVec[0]);
-       int64_t iTemp = 0;
+       // 16bit > 10bit packed conversion, 4 values (8 bytes) into 5 bytes
+       std::vector<unsigned char> tmp( ( uiWidth + 3 ) / 4 * 5 );
 
        for( uint32_t y = 0; y < uiHeight; y++ )
        {
-         for (uint32_t x = 0; x < uiWidth; x+=4)
-         {
-           // write 4 values(8 bytes) into 5 bytes
-           iTemp = (((int64_t)p[x+0])<<0) + (((int64_t)p[x+1])<<10) + (((int64_t)p[x+2])<<20) + (((int64_t)p[x+3])<<30);
-           buf[0] = (iTemp >> 0  ) & 0xff;
-           buf[1] = (iTemp >> 8  ) & 0xff;
-           buf[2] = (iTemp >> 16 ) & 0xff;
-           buf[3] = (iTemp >> 24 ) & 0xff;
-           buf[4] = (iTemp >> 32 ) & 0xff;
-           f->write( (char*)buf, 5 );
-         }
-         p += (plane->stride >> 1);
+         size_t bytes = PackRow10( reinterpret_cast<const uint16_t*>( plane->ptr + y * plane->stride ), &tmp[0], uiWidth );
+         f->write( (char*)&tmp[0], bytes );
 
-         if( p2 )
+         if( planeField2 )
          {
-           for (uint32_t x = 0; x < uiWidth; x+=4)
-           {
-            iTemp = (((int64_t)p[x+0])<<0) + (((int64_t)p[x+1])<<10) + (((int64_t)p[x+2])<<20) + (((int64_t)p[x+3])<<30);
-            buf[0] = (iTemp >> 0  ) & 0xff;
-            buf[1] = (iTemp >> 8  ) & 0xff;
-            buf[2] = (iTemp >> 16 ) & 0xff;
-            buf[3] = (iTemp >> 24 ) & 0xff;
-            buf[4] = (iTemp >> 32 ) & 0xff;
-            f->write( (char*)buf, 5 );
-           }
-           p2 += (planeField2->stride >> 1);
+           bytes = PackRow10( reinterpret_cast<const uint16_t*>( planeField2->ptr + y * planeField2->stride ), &tmp[0], uiWidth );
+           f->write( (char*)&tmp[0], bytes );
          }
        }
      }
@@ -470,79 +538,41 @@ static int _writeComponentToFile( std::ostream *f, vvdecPlane *plane, vvdecPlane
    if( uiBytesPerSample == 2 )
    {
      // 8bit > 16bit conversion
-     std::vector<short> tmp;
-     std::vector<short> tmp2;
-     tmp.resize(uiWidth);
-
-     if( p2 )
-     {
-       tmp2.resize(uiWidth);
-     }
+     std::vector<int16_t> tmp( uiWidth );
 
      for( uint32_t y = 0; y < uiHeight; y++ )
      {
-       for( uint32_t x = 0; x < uiWidth; x++ )
-       {
-         tmp[x] = p[x];
-       }
-       f->write( (char*)&tmp[0], sizeof(std::vector<short>::value_type)*tmp.size());
+       WidenRow8To16( p, &tmp[0], uiWidth );
+       f->write( (char*)&tmp[0], sizeof(int16_t)*uiWidth );
        p += plane->stride;
 
        if( p2 )
        {
-         for( uint32_t x = 0; x < uiWidth; x++ )
-         {
-           tmp2[x] = p2[x];
-         }
-         f->write( (char*)&tmp2[0], sizeof(std::vector<short>::value_type)*tmp2.size());
+         WidenRow8To16( p2, &tmp[0], uiWidth );
+         f->write( (char*)&tmp[0], sizeof(int16_t)*uiWidth );
          p2 += planeField2->stride;
        }
      }
    }
    else if( writePYUV)
    {
-     // 8bit > 10bit packed conversion
-     unsigned char* p  = plane->ptr ;
-     unsigned char* p2 = planeField2 ? planeField2->ptr : nullptr;
-     std::vector<unsigned char> bufVec(5);
-     unsigned char *buf=&(bufVec[0]);
-     int64_t iTemp = 0;
+     // 8bit > 10bit packed conversion, scaled to 10 bit first
+     const uint32_t uiPaddedWidth = ( uiWidth + 3 ) / 4 * 4;
+     std::vector<int16_t> samples( uiPaddedWidth, 0 );
+     std::vector<unsigned char> tmp( uiPaddedWidth / 4 * 5 );
 
      for( uint32_t y = 0; y < uiHeight; y++ )
      {
-       for (uint32_t x = 0; x < uiWidth; x+=4)
-       {
-         // write 4 values(4 bytes) into 5 bytes
-         const unsigned short src0 = (unsigned short)(p[x+0]<<2);
-         const unsigned short src1 = (unsigned short)(p[x+1]<<2);
-         const unsigned short src2 = (unsigned short)(p[x+2]<<2);
-         const unsigned short src3 = (unsigned short)(p[x+3]<<2);
-         iTemp = (((int64_t)src0)<<0) + (((int64_t)src1)<<10) + (((int64_t)src2)<<20) + (((int64_t)src3)<<30);
-         buf[0] = (iTemp >> 0  ) & 0xff;
-         buf[1] = (iTemp >> 8  ) & 0xff;
-         buf[2] = (iTemp >> 16 ) & 0xff;
-         buf[3] = (iTemp >> 24 ) & 0xff;
-         buf[4] = (iTemp >> 32 ) & 0xff;
-         f->write( (char*)buf, 5 );
-       }
+       WidenRow8To16( p, &samples[0], uiWidth, 2 );
+       size_t bytes = PackRow10( reinterpret_cast<const uint16_t*>( &samples[0] ), &tmp[0], uiWidth );
+       f->write( (char*)&tmp[0], bytes );
        p += plane->stride;
 
        if( p2 )
        {
-         for (uint32_t x = 0; x < uiWidth; x+=4)
-         {
-           const unsigned short src0 = (unsigned short)(p2[x+0]<<2);
-           const unsigned short src1 = (unsigned short)(p2[x+1]<<2);
-           const unsigned short src2 = (unsigned short)(p2[x+2]<<2);
-           const unsigned short src3 = (unsigned short)(p2[x+3]<<2);
-           iTemp = (((int64_t)src0)<<0) + (((int64_t)src1)<<10) + (((int64_t)src2)<<20) + (((int64_t)src3)<<30);
-           buf[0] = (iTemp >> 0  ) & 0xff;
-           buf[1] = (iTemp >> 8  ) & 0xff;
-           buf[2] = (iTemp >> 16 ) & 0xff;
-           buf[3] = (iTemp >> 24 ) & 0xff;
-           buf[4] = (iTemp >> 32 ) & 0xff;
-           f->write( (char*)buf, 5 );
-         }
+         WidenRow8To16( p2, &samples[0], uiWidth, 2 );
+         bytes = PackRow10( reinterpret_cast<const uint16_t*>( &samples[0] ), &tmp[0], uiWidth );
+         f->write( (char*)&tmp[0], bytes );
          p2 += planeField2->stride;
        }
      }
@@ -0,0 +1,157 @@
+#include "yuv_mmap_reader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_system/log_system.h"
+#include "pixel_convert.h"
+
+YuvMmapReader::YuvMmapReader()
+    : fd_(-1),
+      data_(nullptr),
+      file_size_(0),
+      width_(0),
+      height_(0),
+      plane_offsets_{0, 0, 0},
+      frame_size_(0),
+      frame_count_(0),
+      position_(0) {}
+
+YuvMmapReader::~YuvMmapReader() { Close(); }
+
+int YuvMmapReader::Open(const std::string& path, int width, int height) {
+  if (IsOpen()) {
+    Close();
+  }
+  if (width <= 0 || height <= 0) {
+    last_error_ = "invalid resolution";
+    return -1;
+  }
+
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    last_error_ = "failed to open " + path + ": " + strerror(errno);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) < 0 || st.st_size <= 0) {
+    last_error_ = "failed to stat " + path + " (or empty file)";
+    Close();
+    return -1;
+  }
+  file_size_ = static_cast<size_t>(st.st_size);
+
+  void* data = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (data == MAP_FAILED) {
+    last_error_ = "failed to map " + path + ": " + strerror(errno);
+    Close();
+    return -1;
+  }
+  data_ = static_cast<const uint8_t*>(data);
+  // Aggressive read-ahead; pages behind the read position may be dropped early
+  madvise(data, file_size_, MADV_SEQUENTIAL);
+
+  // 8-bit 4:2:0 layout, chroma planes subsampled like vvencYUVBuffer's
+  width_ = width;
+  height_ = height;
+  size_t luma_size = static_cast<size_t>(width) * height;
+  size_t chroma_size = static_cast<size_t>(width >> 1) * (height >> 1);
+  plane_offsets_[0] = 0;
+  plane_offsets_[1] = luma_size;
+  plane_offsets_[2] = luma_size + chroma_size;
+  frame_size_ = luma_size + 2 * chroma_size;
+  frame_count_ = static_cast<int64_t>(file_size_ / frame_size_);
+  position_ = 0;
+
+  if (file_size_ % frame_size_ != 0) {
+    LOG(WARNING) << "[YuvMmapReader] " << path << " ends with a partial frame ("
+                 << file_size_ % frame_size_ << " bytes ignored)";
+  }
+  LOG(INFO) << "[YuvMmapReader] Mapped " << path << ": " << frame_count_
+            << " frames of " << width << "x" << height;
+
+  Prefetch(0);
+  return 0;
+}
+
+void YuvMmapReader::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), file_size_);
+    data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  file_size_ = 0;
+  frame_count_ = 0;
+  position_ = 0;
+}
+
+void YuvMmapReader::Seek(int64_t frame_index) {
+  position_ = frame_index;
+  Prefetch(frame_index);
+}
+
+void YuvMmapReader::Prefetch(int64_t frame_index) {
+  if (frame_index < 0 || frame_index >= frame_count_) {
+    return;
+  }
+  // madvise needs a page-aligned start
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t start = static_cast<size_t>(frame_index) * frame_size_;
+  size_t aligned_start = start & ~(page_size - 1);
+  madvise(const_cast<uint8_t*>(data_) + aligned_start,
+          start + frame_size_ - aligned_start, MADV_WILLNEED);
+}
+
+int YuvMmapReader::ReadFrame(int64_t frame_index, vvencYUVBuffer* buffer) {
+  if (!IsOpen()) {
+    last_error_ = "file not open";
+    return -1;
+  }
+  if (frame_index < 0 || frame_index >= frame_count_) {
+    last_error_ = "frame index " + std::to_string(frame_index) + " out of range";
+    return -1;
+  }
+  if (buffer->planes[0].width != width_ || buffer->planes[0].height != height_ ||
+      buffer->planes[1].width != (width_ >> 1) || buffer->planes[1].height != (height_ >> 1) ||
+      buffer->planes[2].width != (width_ >> 1) || buffer->planes[2].height != (height_ >> 1)) {
+    last_error_ = "buffer size does not match the file resolution";
+    return -1;
+  }
+
+  // Start loading the next frame while this one is converted
+  Prefetch(frame_index + 1);
+
+  const uint8_t* frame = data_ + static_cast<size_t>(frame_index) * frame_size_;
+  for (int comp = 0; comp < 3; comp++) {
+    const vvencYUVPlane& plane = buffer->planes[comp];
+    const uint8_t* src = frame + plane_offsets_[comp];
+    int16_t* dst = plane.ptr;
+    for (int y = 0; y < plane.height; y++) {
+      WidenRow8To16(src, dst, plane.width);
+      src += plane.width;
+      dst += plane.stride;
+    }
+  }
+  return 0;
+}
+
+int YuvMmapReader::ReadNextFrame(vvencYUVBuffer* buffer, bool* eof) {
+  *eof = position_ >= frame_count_;
+  if (*eof) {
+    last_error_ = "end of file";
+    return 0;
+  }
+  int ret = ReadFrame(position_, buffer);
+  if (ret == 0) {
+    position_++;
+  }
+  return ret;
+}
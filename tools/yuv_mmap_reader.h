@@ -0,0 +1,68 @@
+#ifndef TOOLS_YUV_MMAP_READER_H
+#define TOOLS_YUV_MMAP_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "vvenc/vvenc.h"
+
+// Memory-mapped reader for raw 8-bit 4:2:0 YUV files. Rows are widened
+// straight from the mapping into the vvencYUVBuffer planes, with no stream
+// layer and no intermediate buffer. The whole file is mapped with
+// MADV_SEQUENTIAL and the frame after the one being read is prefetched with
+// MADV_WILLNEED, so sequential capture rarely waits for the disk.
+// Frames are addressed by index, so callers can seek or loop for free.
+class YuvMmapReader {
+ public:
+  YuvMmapReader();
+  ~YuvMmapReader();
+
+  YuvMmapReader(const YuvMmapReader&) = delete;
+  YuvMmapReader& operator=(const YuvMmapReader&) = delete;
+
+  // Map a file holding frames of width x height
+  // Returns 0 on success, negative value on error (see GetLastError)
+  int Open(const std::string& path, int width, int height);
+
+  // Unmap the file
+  void Close();
+
+  bool IsOpen() const { return data_ != nullptr; }
+
+  // Number of complete frames in the file
+  int64_t GetFrameCount() const { return frame_count_; }
+
+  // Index of the frame ReadNextFrame returns next
+  int64_t GetPosition() const { return position_; }
+
+  // Move the sequential read position to frame_index
+  void Seek(int64_t frame_index);
+
+  // Convert frame frame_index into buffer (planes sized for this resolution)
+  // Returns 0 on success, negative value on error or out of range index
+  int ReadFrame(int64_t frame_index, vvencYUVBuffer* buffer);
+
+  // Read the frame at the current position and advance; eof is set (and 0
+  // returned) once every frame has been read
+  int ReadNextFrame(vvencYUVBuffer* buffer, bool* eof);
+
+  std::string GetLastError() const { return last_error_; }
+
+ private:
+  // Ask the kernel to start reading frame_index in the background
+  void Prefetch(int64_t frame_index);
+
+  int fd_;
+  const uint8_t* data_;
+  size_t file_size_;
+  int width_;
+  int height_;
+  size_t plane_offsets_[3];
+  size_t frame_size_;
+  int64_t frame_count_;
+  int64_t position_;
+  std::string last_error_;
+};
+
+#endif  // TOOLS_YUV_MMAP_READER_H
@@ -19,17 +19,7 @@ DecoderWithFeedback::~DecoderWithFeedback() {
 
 int DecoderWithFeedback::HandlePacketMessage(const uint8_t* packet_data,
                                              size_t packet_size) {
-  // Initialize feedback sender on first packet if not already initialized
-  if (!feedback_sender_initialized_) {
-    if (InitializeFeedbackSender()) {
-      decoder_->SetFeedbackSender(&feedback_sender_);
-      feedback_sender_initialized_ = true;
-      LOG(INFO) << "[DecoderWithFeedback] Feedback sender initialized";
-    } else {
-      LOG(WARNING) << "[DecoderWithFeedback] Failed to initialize feedback sender, "
-                      "continuing without feedback";
-    }
-  }
+  EnsureFeedbackSender();
 
   // Forward packet to decoder
   if (decoder_) {
@@ -39,6 +29,32 @@ int DecoderWithFeedback::HandlePacketMessage(const uint8_t* packet_data,
   return -1;
 }
 
+int DecoderWithFeedback::HandlePacketBatch(const ReceivedPacket* packets,
+                                           size_t count) {
+  EnsureFeedbackSender();
+
+  // Forward the batch to decoder with a single call
+  if (decoder_) {
+    return decoder_->HandlePacketBatch(packets, count);
+  }
+
+  return -1;
+}
+
+void DecoderWithFeedback::EnsureFeedbackSender() {
+  if (feedback_sender_initialized_) {
+    return;
+  }
+  if (InitializeFeedbackSender()) {
+    decoder_->SetFeedbackSender(&feedback_sender_);
+    feedback_sender_initialized_ = true;
+    LOG(INFO) << "[DecoderWithFeedback] Feedback sender initialized";
+  } else {
+    LOG(WARNING) << "[DecoderWithFeedback] Failed to initialize feedback sender, "
+                    "continuing without feedback";
+  }
+}
+
 bool DecoderWithFeedback::InitializeFeedbackSender() {
   if (!message_receiver_) {
     return false;
@@ -18,10 +18,16 @@ class DecoderWithFeedback : public MessageHandler {
   int HandlePacketMessage(const uint8_t* packet_data,
                           size_t packet_size) override;
 
+  // HandlePacketBatch implementation, forwards the whole batch to decoder
+  int HandlePacketBatch(const ReceivedPacket* packets, size_t count) override;
+
  private:
   // Initialize feedback sender with sender's address
   bool InitializeFeedbackSender();
 
+  // Initialize feedback sender on first packet if not already initialized
+  void EnsureFeedbackSender();
+
   Decoder* decoder_;
   MessageReceiver* message_receiver_;
   MessageSender feedback_sender_;
@@ -4,6 +4,12 @@
 #include <cstddef>
 #include <cstdint>
 
+// A received datagram, as handed to MessageHandler::HandlePacketBatch
+struct ReceivedPacket {
+  const uint8_t* data;  // Raw packet data including header
+  size_t size;          // Size of the packet data in bytes
+};
+
 // MessageHandler base class for handling received packets
 // Derived classes can implement different handling strategies
 // (e.g., decoding, logging, forwarding, etc.)
@@ -18,6 +24,20 @@ class MessageHandler {
   // Returns 0 on success, negative value on error
   virtual int HandlePacketMessage(const uint8_t* packet_data,
                                   size_t packet_size) = 0;
+
+  // Handle a batch of received packets (one recvmmsg() worth)
+  // Packet data is only valid for the duration of the call
+  // Default implementation forwards each packet to HandlePacketMessage
+  // Returns 0 on success, negative value if any packet failed
+  virtual int HandlePacketBatch(const ReceivedPacket* packets, size_t count) {
+    int ret = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (HandlePacketMessage(packets[i].data, packets[i].size) != 0) {
+        ret = -1;
+      }
+    }
+    return ret;
+  }
 };
 
 #endif  // TRANSMISSION_MESSAGE_HANDLER_H
@@ -1,21 +1,80 @@
 #include "message_receiver.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cerrno>
 #include <cstring>
+#include <limits>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <netinet/udp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 #include "log_system/log_system.h"
 
+#ifdef __linux__
+// Control buffer space per ring slot for the UDP_GRO segment size cmsg
+static constexpr size_t kGroControlSize = CMSG_SPACE(sizeof(int));
+
+// Batches drained per readiness event before yielding to timers and other
+// sockets on the same event loop
+static constexpr int kMaxBatchesPerWakeup = 16;
+
+// Read the UDP_GRO segment size from a received message's control data
+// Returns 0 if the datagram was not coalesced
+static size_t GroSegmentSize(struct msghdr* hdr) {
+  size_t segment_size = 0;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int gso_size = 0;
+      memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+      segment_size = static_cast<size_t>(gso_size);
+    }
+  }
+  return segment_size;
+}
+#endif
+
+#ifdef HAVE_IO_URING
+// Provided buffer group of the multishot receive, and buffers per ring
+static constexpr uint16_t kUringBufferGroup = 0;
+static constexpr uint16_t kUringBufferCount = 256;
+static constexpr uint16_t kUringGroBufferCount = 64;
+#endif
+
 MessageReceiver::MessageReceiver()
     : socket_fd_(-1),
       listen_port_(0),
       initialized_(false),
       stop_requested_(false),
       message_handler_(nullptr),
+      batch_size_(32),
+      slot_size_(kSlotSize),
+      gro_requested_(false),
+      gro_enabled_(false),
+      reuse_port_(false),
+      uring_requested_(false),
+      busy_poll_budget_(0),
+      packet_count_(0),
       last_sender_port_(0),
-      has_sender_info_(false) {}
+      has_sender_info_(false) {
+  memset(&last_sender_addr_, 0, sizeof(last_sender_addr_));
+#ifdef __linux__
+  event_loop_ = nullptr;
+#endif
+#ifdef HAVE_IO_URING
+  uring_event_fd_ = -1;
+  memset(&uring_msg_, 0, sizeof(uring_msg_));
+  uring_buffer_size_ = 0;
+  uring_receive_ok_ = false;
+#endif
+}
 
 MessageReceiver::~MessageReceiver() { Close(); }
 
@@ -34,6 +93,16 @@ int MessageReceiver::Initialize(int listen_port) {
     return -1;
   }
 
+  if (reuse_port_) {
+    int one = 1;
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+      LOG(ERROR) << "[MessageReceiver] Failed to set SO_REUSEPORT: " << strerror(errno);
+      close(socket_fd_);
+      socket_fd_ = -1;
+      return -1;
+    }
+  }
+
   // Set up local address for binding
   struct sockaddr_in local_addr;
   memset(&local_addr, 0, sizeof(local_addr));
@@ -49,15 +118,160 @@ int MessageReceiver::Initialize(int listen_port) {
     return -1;
   }
 
+  gro_enabled_ = false;
+  slot_size_ = kSlotSize;
+#ifdef __linux__
+  if (gro_requested_) {
+    int one = 1;
+    if (setsockopt(socket_fd_, SOL_UDP, UDP_GRO, &one, sizeof(one)) == 0) {
+      gro_enabled_ = true;
+      slot_size_ = kGroSlotSize;
+    } else {
+      LOG(WARNING) << "[MessageReceiver] UDP_GRO not supported ("
+                   << strerror(errno) << "), receiving single datagrams";
+    }
+  }
+#else
+  if (gro_requested_) {
+    LOG(WARNING) << "[MessageReceiver] UDP_GRO not available on this platform";
+  }
+#endif
+#ifndef HAVE_IO_URING
+  if (uring_requested_) {
+    LOG(WARNING) << "[MessageReceiver] io_uring not available on this platform";
+  }
+#endif
+#ifndef __linux__
+  if (busy_poll_budget_.count() > 0) {
+    LOG(WARNING) << "[MessageReceiver] Busy polling not available on this platform";
+  }
+#endif
+
+  AllocateRing();
+
+#ifdef __linux__
+  // The event loop drains the socket until it would block
+  int flags = fcntl(socket_fd_, F_GETFL, 0);
+  if (flags < 0 || fcntl(socket_fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+    LOG(ERROR) << "[MessageReceiver] Failed to set O_NONBLOCK: " << strerror(errno);
+    close(socket_fd_);
+    socket_fd_ = -1;
+    return -1;
+  }
+
+#ifdef HAVE_IO_URING
+  if (uring_requested_ && !SetupUringReceive()) {
+    LOG(WARNING) << "[MessageReceiver] io_uring receive unavailable, using recvmmsg";
+  }
+  if (uring_ && busy_poll_budget_.count() > 0) {
+    LOG(WARNING) << "[MessageReceiver] Busy polling is not combined with io_uring receive";
+    busy_poll_budget_ = std::chrono::microseconds(0);
+  }
+#endif
+
+  if (busy_poll_budget_.count() > 0) {
+    // Lets the kernel poll the device queue from recvmmsg instead of waiting
+    // for the interrupt; raising it above net.core.busy_read needs
+    // CAP_NET_ADMIN, the user-space spin works either way
+    int busy_poll_us = static_cast<int>(std::min<int64_t>(
+        busy_poll_budget_.count(), std::numeric_limits<int>::max()));
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us,
+                   sizeof(busy_poll_us)) < 0) {
+      LOG(WARNING) << "[MessageReceiver] SO_BUSY_POLL not set (" << strerror(errno)
+                   << "), spinning in user space only";
+    }
+  }
+
+  own_loop_ = std::make_unique<EventLoop>();
+  if (own_loop_->Initialize() != 0 || WatchInput(own_loop_.get()) != 0) {
+    LOG(ERROR) << "[MessageReceiver] Failed to set up event loop";
+    own_loop_.reset();
+    close(socket_fd_);
+    socket_fd_ = -1;
+    return -1;
+  }
+  event_loop_ = own_loop_.get();
+#endif
+
   initialized_ = true;
   stop_requested_ = false;
   message_handler_ = nullptr;
+  stats_ = ReceiveStats();
 
-  LOG(INFO) << "[MessageReceiver] Initialized: listening on port " << listen_port_;
+  LOG(INFO) << "[MessageReceiver] Initialized: listening on port " << listen_port_
+            << " batch_size=" << batch_size_
+            << " gro=" << (gro_enabled_ ? "on" : "off")
+            << " busy_poll_us=" << busy_poll_budget_.count()
+#ifdef HAVE_IO_URING
+            << " io_uring=" << (uring_ ? "on" : "off")
+#endif
+            ;
 
   return 0;
 }
 
+void MessageReceiver::AllocateRing() {
+  // Allocate the receive ring once, so the receive loop never allocates
+  ring_buffer_.assign(batch_size_ * slot_size_, 0);
+  ring_iovecs_.resize(batch_size_);
+  ring_addrs_.resize(batch_size_);
+  packets_.resize(gro_enabled_ ? batch_size_ * kMaxGroSegments : batch_size_);
+  for (size_t i = 0; i < batch_size_; i++) {
+    ring_iovecs_[i].iov_base = ring_buffer_.data() + i * slot_size_;
+    ring_iovecs_[i].iov_len = slot_size_;
+  }
+#ifdef __linux__
+  ring_msgs_.resize(batch_size_);
+  ring_control_.assign(gro_enabled_ ? batch_size_ * kGroControlSize : 0, 0);
+  for (size_t i = 0; i < batch_size_; i++) {
+    memset(&ring_msgs_[i], 0, sizeof(ring_msgs_[i]));
+    ring_msgs_[i].msg_hdr.msg_iov = &ring_iovecs_[i];
+    ring_msgs_[i].msg_hdr.msg_iovlen = 1;
+    ring_msgs_[i].msg_hdr.msg_name = &ring_addrs_[i];
+  }
+#endif
+}
+
+void MessageReceiver::SetReceiveBatchSize(size_t batch_size) {
+  if (initialized_) {
+    LOG(WARNING) << "[MessageReceiver] Batch size must be set before Initialize";
+    return;
+  }
+  batch_size_ = batch_size > 0 ? batch_size : 1;
+}
+
+void MessageReceiver::SetGroEnabled(bool enabled) {
+  if (initialized_) {
+    LOG(WARNING) << "[MessageReceiver] GRO must be set before Initialize";
+    return;
+  }
+  gro_requested_ = enabled;
+}
+
+void MessageReceiver::SetReusePort(bool enabled) {
+  if (initialized_) {
+    LOG(WARNING) << "[MessageReceiver] SO_REUSEPORT must be set before Initialize";
+    return;
+  }
+  reuse_port_ = enabled;
+}
+
+void MessageReceiver::SetIoUringEnabled(bool enabled) {
+  if (initialized_) {
+    LOG(WARNING) << "[MessageReceiver] io_uring must be set before Initialize";
+    return;
+  }
+  uring_requested_ = enabled;
+}
+
+void MessageReceiver::SetBusyPoll(std::chrono::microseconds spin_budget) {
+  if (initialized_) {
+    LOG(WARNING) << "[MessageReceiver] Busy polling must be set before Initialize";
+    return;
+  }
+  busy_poll_budget_ = std::max(spin_budget, std::chrono::microseconds(0));
+}
+
 void MessageReceiver::SetMessageHandler(MessageHandler* handler) {
   message_handler_ = handler;
   LOG(VERBOSE) << "[MessageReceiver] Message handler set";
@@ -71,75 +285,472 @@ void MessageReceiver::Run() {
 
   LOG(INFO) << "[MessageReceiver] Starting receiver loop...";
 
-  const size_t buffer_size = 1500;  // Standard Ethernet MTU
-  std::vector<uint8_t> buffer(buffer_size);
-
+#ifdef __linux__
+  if (stop_requested_) {
+    // Stopped before the loop started
+  } else if (busy_poll_budget_.count() > 0) {
+    RunBusyPoll();
+  } else {
+    event_loop_->Run();
+  }
+#else
   while (!stop_requested_) {
-    ssize_t bytes_received = 0;
-    int ret = ReceivePacket(buffer.data(), buffer_size, bytes_received);
+    int count = ReceiveBatch();
 
-    if (ret == 0 && bytes_received > 0) {
-      // Pass packet directly to message handler
+    if (count > 0) {
+      // Pass the whole batch to the message handler
       if (message_handler_) {
-        message_handler_->HandlePacketMessage(buffer.data(),
-                                             static_cast<size_t>(bytes_received));
+        message_handler_->HandlePacketBatch(packets_.data(),
+                                            static_cast<size_t>(count));
       }
-    } else if (ret < 0 && !stop_requested_) {
+      stats_.batches++;
+    } else if (count < 0 && !stop_requested_) {
       // Error receiving, but continue if not stopped
       LOG(WARNING) << "[MessageReceiver] Error receiving packet, continuing...";
     }
   }
+#endif
 
   LOG(INFO) << "[MessageReceiver] Receiver loop stopped";
 }
 
-int MessageReceiver::ReceivePacket(uint8_t* buffer, size_t buffer_size,
-                                    ssize_t& bytes_received) {
+#ifdef __linux__
+int MessageReceiver::WatchInput(EventLoop* loop) {
+  if (busy_poll_budget_.count() > 0) {
+    // RunBusyPoll drains the socket itself, readiness only ends a sleep
+    return loop->AddFd(socket_fd_, EPOLLIN, [this](uint32_t) {
+      busy_poll_wakeup_ = std::chrono::steady_clock::now();
+    });
+  }
+#ifdef HAVE_IO_URING
+  if (uring_) {
+    return loop->AddFd(uring_event_fd_, EPOLLIN,
+                       [this](uint32_t) { OnUringCompletions(); });
+  }
+#endif
+  return loop->AddFd(socket_fd_, EPOLLIN, [this](uint32_t) { OnSocketReadable(); });
+}
+
+int MessageReceiver::GetInputFd() const {
+#ifdef HAVE_IO_URING
+  if (uring_) {
+    return uring_event_fd_;
+  }
+#endif
+  return socket_fd_;
+}
+
+void MessageReceiver::OnSocketReadable() {
+  for (int i = 0; i < kMaxBatchesPerWakeup && !stop_requested_; i++) {
+    int count = ReceiveBatch();
+    if (count <= 0) {
+      // Drained (EAGAIN), or an error that ReceiveBatch already logged
+      break;
+    }
+    if (message_handler_) {
+      message_handler_->HandlePacketBatch(packets_.data(),
+                                          static_cast<size_t>(count));
+    }
+    stats_.batches++;
+  }
+}
+
+void MessageReceiver::RunBusyPoll() {
+  using Clock = std::chrono::steady_clock;
+  // Timers and other fds on the loop are still serviced while spinning
+  const auto kLoopPollInterval = std::chrono::milliseconds(1);
+
+  auto spin_start = Clock::now();
+  auto idle_since = spin_start;
+  auto last_loop_poll = spin_start;
+  while (!stop_requested_) {
+    int count = ReceiveBatch();
+    if (count > 0) {
+      if (message_handler_) {
+        message_handler_->HandlePacketBatch(packets_.data(),
+                                            static_cast<size_t>(count));
+      }
+      stats_.batches++;
+      idle_since = Clock::now();
+      continue;
+    }
+
+    auto now = Clock::now();
+    if (now - idle_since < busy_poll_budget_) {
+      if (now - last_loop_poll >= kLoopPollInterval) {
+        event_loop_->RunOnce(0);
+        last_loop_poll = now;
+      }
+      continue;
+    }
+
+    // Spin budget used up without traffic: sleep until the socket is ready
+    stats_.busy_poll_spin_ns += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - spin_start).count());
+    stats_.busy_poll_sleeps++;
+    busy_poll_wakeup_ = Clock::time_point();
+    event_loop_->RunOnce(-1);
+    auto woke = busy_poll_wakeup_ != Clock::time_point() ? busy_poll_wakeup_
+                                                          : Clock::now();
+    stats_.busy_poll_sleep_ns += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(woke - now).count());
+    spin_start = last_loop_poll = woke;
+    if (busy_poll_wakeup_ != Clock::time_point()) {
+      idle_since = woke;
+    }
+    // Otherwise a timer woke us: check the socket once and sleep again
+  }
+  stats_.busy_poll_spin_ns += static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - spin_start)
+          .count());
+}
+
+#endif
+
+int MessageReceiver::ReceiveBatch() {
   if (socket_fd_ < 0) {
     return -1;
   }
 
-  struct sockaddr_in sender_addr;
-  socklen_t sender_addr_len = sizeof(sender_addr);
-
-  bytes_received = recvfrom(socket_fd_, buffer, buffer_size, 0,
-                            (struct sockaddr*)&sender_addr, &sender_addr_len);
+#ifdef __linux__
+  for (size_t i = 0; i < batch_size_; i++) {
+    ring_msgs_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    if (gro_enabled_) {
+      ring_msgs_[i].msg_hdr.msg_control = &ring_control_[i * kGroControlSize];
+      ring_msgs_[i].msg_hdr.msg_controllen = kGroControlSize;
+    }
+  }
 
-  if (bytes_received < 0) {
-    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+  // The socket is non-blocking: take whatever is queued, EAGAIN if nothing
+  int count = recvmmsg(socket_fd_, ring_msgs_.data(),
+                       static_cast<unsigned int>(batch_size_), 0, nullptr);
+#else
+  socklen_t sender_addr_len = sizeof(struct sockaddr_in);
+  ssize_t bytes_received =
+      recvfrom(socket_fd_, ring_iovecs_[0].iov_base, slot_size_, 0,
+               (struct sockaddr*)&ring_addrs_[0], &sender_addr_len);
+  int count = bytes_received < 0 ? -1 : 1;
+#endif
+
+  if (count < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
       // Timeout or would block - not an error
       return 0;
     }
     if (!stop_requested_) {
-      LOG(ERROR) << "[MessageReceiver] recvfrom() failed: " << strerror(errno);
+      LOG(ERROR) << "[MessageReceiver] receive failed: " << strerror(errno);
     }
     return -1;
   }
 
+  packet_count_ = 0;
+  for (int i = 0; i < count; i++) {
+    size_t segment_size = 0;
+#ifdef __linux__
+    size_t size = ring_msgs_[i].msg_len;
+    if (gro_enabled_) {
+      segment_size = GroSegmentSize(&ring_msgs_[i].msg_hdr);
+    }
+#else
+    size_t size = static_cast<size_t>(bytes_received);
+#endif
+    // Zero-length reads are how shutdown() wakes up a blocked receive
+    // (non-Linux Stop)
+    if (size == 0) {
+      continue;
+    }
+    UpdateSenderInfo(ring_addrs_[i]);
+    AddReceivedSlot(static_cast<const uint8_t*>(ring_iovecs_[i].iov_base), size,
+                    segment_size);
+  }
+  stats_.syscalls++;
+
+  return static_cast<int>(packet_count_);
+}
+
+#ifdef HAVE_IO_URING
+bool MessageReceiver::SetupUringReceive() {
+  if (!IoUringEngine::IsSupported()) {
+    return false;
+  }
+
+  // Every receive completion holds a provided buffer until it is returned,
+  // so a completion queue (2 x entries) larger than the buffer count cannot
+  // overflow. An overflow would silently end the multishot request.
+  uint16_t count = gro_enabled_ ? kUringGroBufferCount : kUringBufferCount;
+  uring_ = std::make_unique<IoUringEngine>();
+  if (uring_->Initialize(count) != 0) {
+    uring_.reset();
+    return false;
+  }
+
+  uring_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (uring_event_fd_ < 0 || uring_->RegisterEventFd(uring_event_fd_) != 0) {
+    LOG(WARNING) << "[MessageReceiver] Failed to set up io_uring eventfd";
+    CloseUringReceive();
+    return false;
+  }
+
+  // Each provided buffer holds an io_uring_recvmsg_out header, the source
+  // address, the control data (GRO segment size) and the datagram
+  memset(&uring_msg_, 0, sizeof(uring_msg_));
+  uring_msg_.msg_namelen = sizeof(struct sockaddr_in);
+  uring_msg_.msg_controllen = gro_enabled_ ? kGroControlSize : 0;
+  uring_buffer_size_ = sizeof(struct io_uring_recvmsg_out) +
+                       uring_msg_.msg_namelen + uring_msg_.msg_controllen +
+                       slot_size_;
+  uring_buffers_.assign(static_cast<size_t>(count) * uring_buffer_size_, 0);
+  uring_held_buffers_.clear();
+  uring_held_buffers_.reserve(count);
+  uring_receive_ok_ = false;
+
+  if (uring_->SetupBufferRing(kUringBufferGroup, uring_buffers_.data(),
+                              uring_buffer_size_, count) != 0 ||
+      ArmUringReceive() != 0) {
+    CloseUringReceive();
+    return false;
+  }
+  return true;
+}
+
+int MessageReceiver::ArmUringReceive() {
+  struct io_uring_sqe* sqe = uring_->GetSqe();
+  if (sqe == nullptr) {
+    return -1;
+  }
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = socket_fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&uring_msg_);
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kUringBufferGroup;
+
+  const uint64_t enter_calls = uring_->GetStats().enter_calls;
+  int ret = uring_->Submit();
+  stats_.syscalls += uring_->GetStats().enter_calls - enter_calls;
+  if (ret < 0) {
+    LOG(ERROR) << "[MessageReceiver] Failed to arm io_uring receive: " << strerror(-ret);
+    return -1;
+  }
+  return 0;
+}
+
+void MessageReceiver::OnUringCompletions() {
+  uint64_t value = 0;
+  if (read(uring_event_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+    LOG(WARNING) << "[MessageReceiver] Failed to read io_uring eventfd: " << strerror(errno);
+  }
+  stats_.syscalls++;
+
+  // A coalesced GRO buffer may expand to kMaxGroSegments packets
+  const size_t packets_per_slot = gro_enabled_ ? kMaxGroSegments : 1;
+  bool rearm = false;
+  packet_count_ = 0;
+
+  struct io_uring_cqe cqe;
+  while (!stop_requested_ && uring_->PopCompletion(&cqe)) {
+    stats_.uring_completions++;
+    // Without F_MORE the multishot request has ended and must be re-armed
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      rearm = true;
+    }
+    if (cqe.res < 0) {
+      // ENOBUFS: every buffer is held, re-armed once they are returned
+      if (cqe.res != -ENOBUFS) {
+        if (!uring_receive_ok_) {
+          LOG(WARNING) << "[MessageReceiver] Multishot recvmsg rejected ("
+                       << strerror(-cqe.res) << "), using recvmmsg";
+          FallBackToSocketReceive();
+          return;
+        }
+        LOG(WARNING) << "[MessageReceiver] io_uring receive failed: " << strerror(-cqe.res);
+      }
+      continue;
+    }
+    if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+      continue;
+    }
+
+    uring_receive_ok_ = true;
+    uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    uring_held_buffers_.push_back(buffer_id);
+    AddUringSlot(uring_->GetBuffer(buffer_id), static_cast<size_t>(cqe.res));
+
+    if (packets_.size() - packet_count_ < packets_per_slot) {
+      DeliverUringBatch();
+    }
+  }
+  DeliverUringBatch();
+
+  if (rearm && !stop_requested_ && ArmUringReceive() != 0) {
+    LOG(ERROR) << "[MessageReceiver] Failed to re-arm io_uring receive";
+  }
+}
+
+void MessageReceiver::AddUringSlot(const uint8_t* buffer, size_t length) {
+  struct io_uring_recvmsg_out out;
+  const size_t header_size = sizeof(out) + uring_msg_.msg_namelen +
+                             uring_msg_.msg_controllen;
+  if (length < header_size) {
+    return;
+  }
+  memcpy(&out, buffer, sizeof(out));
+  const uint8_t* name = buffer + sizeof(out);
+  const uint8_t* control = name + uring_msg_.msg_namelen;
+  const uint8_t* payload = buffer + header_size;
+
+  size_t segment_size = 0;
+  if (gro_enabled_ && out.controllen > 0) {
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_control = const_cast<uint8_t*>(control);
+    hdr.msg_controllen = out.controllen;
+    segment_size = GroSegmentSize(&hdr);
+  }
+
+  if (out.namelen >= sizeof(struct sockaddr_in)) {
+    struct sockaddr_in addr;
+    memcpy(&addr, name, sizeof(addr));
+    UpdateSenderInfo(addr);
+  }
+
+  // payloadlen is the datagram size, which exceeds the buffer if truncated
+  size_t size = std::min<size_t>(out.payloadlen, length - header_size);
+  if (size > 0) {
+    AddReceivedSlot(payload, size, segment_size);
+  }
+}
+
+void MessageReceiver::DeliverUringBatch() {
+  if (packet_count_ > 0) {
+    if (message_handler_) {
+      message_handler_->HandlePacketBatch(packets_.data(), packet_count_);
+    }
+    stats_.batches++;
+    packet_count_ = 0;
+  }
+  for (uint16_t buffer_id : uring_held_buffers_) {
+    uring_->ReturnBuffer(buffer_id);
+  }
+  uring_held_buffers_.clear();
+}
+
+void MessageReceiver::FallBackToSocketReceive() {
+  if (event_loop_ != nullptr && uring_event_fd_ >= 0) {
+    event_loop_->RemoveFd(uring_event_fd_);
+  }
+  CloseUringReceive();
+  if (event_loop_ != nullptr) {
+    WatchInput(event_loop_);
+  }
+}
+
+void MessageReceiver::CloseUringReceive() {
+  // Closing the ring cancels the multishot request before the buffers go
+  uring_.reset();
+  uring_buffers_.clear();
+  uring_held_buffers_.clear();
+  if (uring_event_fd_ >= 0) {
+    close(uring_event_fd_);
+    uring_event_fd_ = -1;
+  }
+}
+#endif
+
+void MessageReceiver::AddReceivedSlot(const uint8_t* data, size_t size,
+                                      size_t segment_size) {
+  if (segment_size == 0 || segment_size >= size) {
+    packets_[packet_count_++] = {data, size};
+    stats_.packets_received++;
+    stats_.bytes_received += size;
+    return;
+  }
+
+  // Coalesced buffer: every segment is segment_size bytes except the last,
+  // matching how the sender lays out PacketHeader-framed packets
+  stats_.gro_datagrams++;
+  for (size_t offset = 0; offset < size && packet_count_ < packets_.size();
+       offset += segment_size) {
+    size_t length = std::min(segment_size, size - offset);
+    packets_[packet_count_++] = {data + offset, length};
+    stats_.packets_received++;
+    stats_.bytes_received += length;
+  }
+}
+
+void MessageReceiver::UpdateSenderInfo(const struct sockaddr_in& addr) {
+  // Sender is almost always unchanged, only format it when it changes
+  if (has_sender_info_ &&
+      addr.sin_addr.s_addr == last_sender_addr_.sin_addr.s_addr &&
+      addr.sin_port == last_sender_addr_.sin_port) {
+    return;
+  }
+
   // Store sender information for feedback
   char ip_str[INET_ADDRSTRLEN];
-  if (inet_ntop(AF_INET, &sender_addr.sin_addr, ip_str, INET_ADDRSTRLEN) != nullptr) {
+  if (inet_ntop(AF_INET, &addr.sin_addr, ip_str, INET_ADDRSTRLEN) != nullptr) {
+    last_sender_addr_ = addr;
     last_sender_ip_ = std::string(ip_str);
-    last_sender_port_ = ntohs(sender_addr.sin_port);
+    last_sender_port_ = ntohs(addr.sin_port);
     has_sender_info_ = true;
+    stats_.sender_changes++;
   }
-
-  return 0;
 }
 
+void MessageReceiver::PrintStats() const {
+  double packets_per_syscall =
+      stats_.syscalls ? static_cast<double>(stats_.packets_received) / stats_.syscalls : 0.0;
+  LOG(INFO) << "[MessageReceiver] Stats: port=" << listen_port_
+            << " packets=" << stats_.packets_received
+            << " bytes=" << stats_.bytes_received
+            << " syscalls=" << stats_.syscalls
+            << " packets/syscall=" << packets_per_syscall
+            << " sender_changes=" << stats_.sender_changes
+            << " gro_datagrams=" << stats_.gro_datagrams
+            << " uring_completions=" << stats_.uring_completions;
+  if (busy_poll_budget_.count() > 0) {
+    uint64_t total_ns = stats_.busy_poll_spin_ns + stats_.busy_poll_sleep_ns;
+    LOG(INFO) << "[MessageReceiver] Busy poll: spin_ms="
+              << stats_.busy_poll_spin_ns / 1000000
+              << " sleep_ms=" << stats_.busy_poll_sleep_ns / 1000000
+              << " sleeps=" << stats_.busy_poll_sleeps << " spin_share="
+              << (total_ns ? 100.0 * stats_.busy_poll_spin_ns / total_ns : 0.0) << "%";
+  }
+}
 
 void MessageReceiver::Stop() {
   stop_requested_ = true;
+#ifdef __linux__
+  // Wake the event loop through its eventfd
+  if (event_loop_ != nullptr) {
+    event_loop_->Stop();
+  }
+#else
   // Wake up recvfrom by closing socket (will be reopened if needed)
   if (socket_fd_ >= 0) {
     shutdown(socket_fd_, SHUT_RD);
   }
+#endif
 }
 
 bool MessageReceiver::IsStopped() const { return stop_requested_.load(); }
 
 void MessageReceiver::Close() {
+#ifdef __linux__
+  // Detach without stopping a loop shared with other sockets
+  stop_requested_ = true;
+  if (event_loop_ != nullptr && socket_fd_ >= 0) {
+    event_loop_->RemoveFd(GetInputFd());
+  }
+  own_loop_.reset();
+  event_loop_ = nullptr;
+#else
   Stop();
+#endif
+#ifdef HAVE_IO_URING
+  CloseUringReceive();
+#endif
 
   if (socket_fd_ >= 0) {
     close(socket_fd_);
@@ -2,15 +2,35 @@
 #define TRANSMISSION_MESSAGE_RECEIVER_H
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <netinet/in.h>
 #include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <vector>
 
+#include "tools/event_loop.h"
+#include "tools/io_uring_engine.h"
 #include "transmission/message_handler.h"
 
+// Receive statistics collected by MessageReceiver
+struct ReceiveStats {
+  uint64_t packets_received = 0;  // Datagrams handed to the message handler
+  uint64_t bytes_received = 0;    // Bytes handed to the message handler
+  uint64_t syscalls = 0;          // Receive syscalls that returned data
+  uint64_t batches = 0;           // HandlePacketBatch calls
+  uint64_t sender_changes = 0;    // Times the sender address changed
+  uint64_t gro_datagrams = 0;     // Coalesced GRO datagrams split in user space
+  uint64_t uring_completions = 0; // io_uring receive completions
+  uint64_t busy_poll_spin_ns = 0; // Busy-poll mode: time spinning or handling
+  uint64_t busy_poll_sleep_ns = 0;// Busy-poll mode: time blocked in epoll_wait
+  uint64_t busy_poll_sleeps = 0;  // Busy-poll mode: spin budget expirations
+};
+
 // MessageReceiver class for receiving encoded video data over UDP
 // Reassembles packets into complete frames and writes to file/handler
 class MessageReceiver {
@@ -22,16 +42,53 @@ class MessageReceiver {
   // Returns 0 on success, negative value on error
   int Initialize(int listen_port);
 
+  // Set how many datagrams one recvmmsg() call may return (default 32)
+  // Must be called before Initialize
+  void SetReceiveBatchSize(size_t batch_size);
+
+  // Enable UDP generic receive offload (Linux 5.0+)
+  // The kernel then delivers runs of same-sized datagrams from one flow as a
+  // single coalesced buffer, which is split back into packets here
+  // Must be called before Initialize; ignored if the kernel lacks UDP_GRO
+  void SetGroEnabled(bool enabled);
+
+  // Set SO_REUSEPORT so several receivers can bind the same port, with the
+  // kernel spreading flows across them (see ShardedMessageReceiver)
+  // Must be called before Initialize
+  void SetReusePort(bool enabled);
+
+  // Receive with an io_uring multishot recvmsg into a provided buffer ring
+  // instead of recvmmsg: one armed request keeps delivering datagrams and
+  // the loop only reads the ring's completion eventfd
+  // Must be called before Initialize; falls back to recvmmsg if io_uring or
+  // multishot recvmsg (Linux 6.0+) is unavailable
+  void SetIoUringEnabled(bool enabled);
+
+  // Busy-poll receive: set SO_BUSY_POLL and keep spinning on non-blocking
+  // recvmmsg for up to spin_budget after the last datagram before blocking
+  // in epoll_wait. Removes the wakeup latency at the cost of a busy core.
+  // Must be called before Initialize; 0 disables. Linux only, and not
+  // combined with io_uring receive
+  void SetBusyPoll(std::chrono::microseconds spin_budget);
+
   // Set message handler for processing received frames
   void SetMessageHandler(MessageHandler* handler);
 
   // Run the receiver loop (blocks until stopped)
   // Continuously receives packets and writes complete frames to file/decoder
+  // On Linux this runs the receiver's event loop (see GetEventLoop), so
+  // timers added to that loop fire on the receive thread
   void Run();
 
-  // Stop the receiver
+  // Stop the receiver (thread-safe)
   void Stop();
 
+#ifdef __linux__
+  // Get the event loop the socket is registered with (nullptr before
+  // Initialize). Timers must be added before Run or from the loop thread.
+  EventLoop* GetEventLoop() { return event_loop_; }
+#endif
+
   // Check if receiver is stopped
   bool IsStopped() const;
 
@@ -45,9 +102,90 @@ class MessageReceiver {
   // Returns true if sender info is available, false otherwise
   bool GetLastSenderInfo(std::string& sender_ip, int& sender_port) const;
 
+  // Get receive statistics
+  const ReceiveStats& GetStats() const { return stats_; }
+
+  // Log receive statistics (packets per syscall)
+  void PrintStats() const;
+
  private:
-  // Receive a single packet
-  int ReceivePacket(uint8_t* buffer, size_t buffer_size, ssize_t& bytes_received);
+  // Ring slot size: one datagram up to the Ethernet MTU, or a whole
+  // coalesced GRO buffer (up to 64 segments, max IP datagram size)
+  static constexpr size_t kSlotSize = 1500;
+  static constexpr size_t kGroSlotSize = 65535;
+  static constexpr size_t kMaxGroSegments = 64;
+
+  // Receive up to batch_size_ datagrams into the buffer ring
+  // Fills packets_ and returns the number received, 0 if nothing was
+  // received, negative value on error
+  int ReceiveBatch();
+
+  // Update the cached sender info if addr differs from the last sender
+  void UpdateSenderInfo(const struct sockaddr_in& addr);
+
+  // Append the packets in a received slot to packets_, splitting a coalesced
+  // GRO buffer at segment_size boundaries (0 means not coalesced)
+  void AddReceivedSlot(const uint8_t* data, size_t size, size_t segment_size);
+
+  // Allocate the receive ring for batch_size_ slots of slot_size_ bytes
+  void AllocateRing();
+
+#ifdef __linux__
+  // Register the fd that signals incoming data (socket, or the io_uring
+  // completion eventfd) with loop
+  int WatchInput(EventLoop* loop);
+
+  // Get the fd registered by WatchInput
+  int GetInputFd() const;
+
+  // Socket readiness callback: drain the socket until it would block
+  void OnSocketReadable();
+
+  // Busy-poll receive loop (see SetBusyPoll)
+  void RunBusyPoll();
+
+  // Busy-poll mode: when epoll_wait last reported the socket readable
+  std::chrono::steady_clock::time_point busy_poll_wakeup_;
+#endif
+
+#ifdef HAVE_IO_URING
+  // Set up the ring, buffers and eventfd and arm the first receive
+  // Returns false if io_uring cannot be used
+  bool SetupUringReceive();
+
+  // Queue a multishot recvmsg on the socket
+  int ArmUringReceive();
+
+  // Completion eventfd callback: hand received datagrams to the handler
+  void OnUringCompletions();
+
+  // Append the datagram in a provided buffer to packets_
+  void AddUringSlot(const uint8_t* buffer, size_t length);
+
+  // Pass packets_ to the handler and give their buffers back to the kernel
+  void DeliverUringBatch();
+
+  // Switch to recvmmsg (kernel without multishot recvmsg)
+  void FallBackToSocketReceive();
+
+  // Release the ring, eventfd and buffers
+  void CloseUringReceive();
+
+  std::unique_ptr<IoUringEngine> uring_;
+  int uring_event_fd_;
+  struct msghdr uring_msg_;  // Name/control layout of the multishot receive
+  std::vector<uint8_t> uring_buffers_;
+  size_t uring_buffer_size_;
+  std::vector<uint16_t> uring_held_buffers_;  // Buffers referenced by packets_
+  bool uring_receive_ok_;  // A receive completed, multishot is supported
+#endif
+
+#ifdef __linux__
+  // Receive loop owned by this receiver, and the loop the socket is
+  // registered with (own_loop_ once initialized)
+  std::unique_ptr<EventLoop> own_loop_;
+  EventLoop* event_loop_;
+#endif
 
   int socket_fd_;
   int listen_port_;
@@ -57,10 +195,33 @@ class MessageReceiver {
   // Message handler for processing received packets
   MessageHandler* message_handler_;
 
+  // Preallocated receive ring: batch_size_ slots of slot_size_ bytes, with
+  // the iovec, source address, control buffer and message header of each
+  size_t batch_size_;
+  size_t slot_size_;
+  bool gro_requested_;
+  bool gro_enabled_;
+  bool reuse_port_;
+  bool uring_requested_;
+  std::chrono::microseconds busy_poll_budget_;
+  std::vector<uint8_t> ring_buffer_;
+  std::vector<struct iovec> ring_iovecs_;
+  std::vector<struct sockaddr_in> ring_addrs_;
+#ifdef __linux__
+  std::vector<struct mmsghdr> ring_msgs_;
+  std::vector<uint8_t> ring_control_;
+#endif
+  // Packets of the current batch (GRO slots expand to several packets)
+  std::vector<ReceivedPacket> packets_;
+  size_t packet_count_;
+
   // Last sender information (for feedback)
+  struct sockaddr_in last_sender_addr_;
   mutable std::string last_sender_ip_;
   mutable int last_sender_port_;
   mutable bool has_sender_info_;
+
+  ReceiveStats stats_;
 };
 
 #endif  // TRANSMISSION_MESSAGE_RECEIVER_H
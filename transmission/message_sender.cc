@@ -1,21 +1,74 @@
 #include "message_sender.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <utility>
 #include <vector>
 
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <netinet/udp.h>
+#endif
+
 #include "log_system/log_system.h"
-#include "packet_header.h"
+
+#ifdef HAVE_IO_URING
+// Submission queue size of the io_uring send mode; larger frames are
+// submitted in several chunks
+static constexpr unsigned kUringSendEntries = 1024;
+#endif
+
+bool ParseSendMode(const std::string& name, SendMode* mode) {
+  if (name == "packet") {
+    *mode = SendMode::kPerPacket;
+  } else if (name == "batch") {
+    *mode = SendMode::kBatched;
+  } else if (name == "gso") {
+    *mode = SendMode::kSegmented;
+  } else if (name == "uring") {
+    *mode = SendMode::kIoUring;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* SendModeName(SendMode mode) {
+  switch (mode) {
+    case SendMode::kPerPacket:
+      return "packet";
+    case SendMode::kBatched:
+      return "batch";
+    case SendMode::kSegmented:
+      return "gso";
+    case SendMode::kIoUring:
+      return "uring";
+  }
+  return "unknown";
+}
 
 MessageSender::MessageSender()
     : socket_fd_(-1),
       dest_port_(0),
       max_packet_size_(1400),
       initialized_(false),
-      packet_sequence_(0) {}
+      packet_sequence_(0),
+      send_mode_(SendMode::kPerPacket),
+      requested_send_mode_(SendMode::kPerPacket),
+      zerocopy_threshold_(0),
+      zerocopy_enabled_(false) {
+#ifdef HAVE_IO_URING
+  uring_pending_ = 0;
+#endif
+}
 
 MessageSender::~MessageSender() { Close(); }
 
@@ -30,6 +83,15 @@ int MessageSender::Initialize(const std::string& dest_ip, int dest_port,
   dest_port_ = dest_port;
   max_packet_size_ = max_packet_size;
   packet_sequence_ = 0;
+  stats_ = SendStats();
+
+  // Enough packets for a typical intra frame; larger frames grow the pools
+  const size_t kInitialPacketPoolSize = 128;
+  header_pool_.resize(kInitialPacketPoolSize);
+  packet_iovecs_.resize(2 * kInitialPacketPoolSize);
+#ifdef __linux__
+  batch_msgs_.resize(kInitialPacketPoolSize);
+#endif
 
   // Create UDP socket
   socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
@@ -60,12 +122,87 @@ int MessageSender::Initialize(const std::string& dest_ip, int dest_port,
   }
 
   initialized_ = true;
+  send_mode_ = ResolveSendMode(requested_send_mode_);
+  if (zerocopy_threshold_ > 0) {
+    SetZeroCopyThreshold(zerocopy_threshold_);
+  }
   LOG(INFO) << "[MessageSender] Initialized: " << dest_ip_ << ":" << dest_port_
-            << " max_packet_size=" << max_packet_size_;
+            << " max_packet_size=" << max_packet_size_
+            << " send_mode=" << SendModeName(send_mode_);
 
   return 0;
 }
 
+void MessageSender::SetSendMode(SendMode mode) {
+  requested_send_mode_ = mode;
+  if (initialized_) {
+    send_mode_ = ResolveSendMode(mode);
+    LOG(INFO) << "[MessageSender] Send mode: " << SendModeName(send_mode_);
+  }
+}
+
+void MessageSender::SetZeroCopyThreshold(size_t threshold) {
+  zerocopy_threshold_ = threshold;
+  if (!initialized_) {
+    return;
+  }
+  zerocopy_enabled_ = false;
+  if (threshold == 0) {
+    return;
+  }
+#ifdef __linux__
+  zerocopy_enabled_ = EnableZeroCopy();
+#else
+  LOG(WARNING) << "[MessageSender] MSG_ZEROCOPY not available on this platform";
+#endif
+  if (zerocopy_enabled_) {
+    LOG(INFO) << "[MessageSender] MSG_ZEROCOPY enabled for frames >= "
+              << zerocopy_threshold_ << " bytes";
+  }
+}
+
+SendMode MessageSender::ResolveSendMode(SendMode mode) {
+#ifdef __linux__
+  if (mode == SendMode::kIoUring) {
+#ifdef HAVE_IO_URING
+    if (!uring_ && IoUringEngine::IsSupported()) {
+      uring_ = std::make_unique<IoUringEngine>();
+      if (uring_->Initialize(kUringSendEntries) != 0) {
+        uring_.reset();
+      }
+    }
+    if (uring_) {
+      return mode;
+    }
+#endif
+    LOG(WARNING) << "[MessageSender] io_uring not available, using sendmmsg batching";
+    return SendMode::kBatched;
+  }
+  if (mode == SendMode::kSegmented) {
+    // Probe GSO support: the kernel rejects UDP_SEGMENT if it lacks UDP GSO.
+    // The socket-wide value is reset right away, SendData passes the segment
+    // size per call so SendRaw is never segmented.
+    int gso_size = static_cast<int>(max_packet_size_);
+    if (setsockopt(socket_fd_, SOL_UDP, UDP_SEGMENT, &gso_size,
+                   sizeof(gso_size)) < 0) {
+      LOG(WARNING) << "[MessageSender] UDP_SEGMENT not supported ("
+                   << strerror(errno) << "), using sendmmsg batching";
+      return SendMode::kBatched;
+    }
+    gso_size = 0;
+    setsockopt(socket_fd_, SOL_UDP, UDP_SEGMENT, &gso_size, sizeof(gso_size));
+  }
+  return mode;
+#else
+  if (mode != SendMode::kPerPacket) {
+    LOG(WARNING) << "[MessageSender] " << SendModeName(mode)
+                 << " send mode not available on this platform, using "
+                    "per-packet send";
+  }
+  return SendMode::kPerPacket;
+#endif
+}
+
 int MessageSender::SendData(const uint8_t* data, size_t data_size,
                             uint32_t frame_sequence) {
   if (!initialized_ || socket_fd_ < 0) {
@@ -90,45 +227,537 @@ int MessageSender::SendData(const uint8_t* data, size_t data_size,
             << " size=" << data_size << " bytes in " << total_packets
             << " packets";
 
-  // Allocate packet buffer (use vector to avoid VLA)
-  std::vector<uint8_t> packet_buffer(max_packet_size_);
+#ifdef HAVE_IO_URING
+  // Without stable submissions the kernel may still read the msghdrs and
+  // iovecs of queued sends, which BuildPackets rewrites
+  if (uring_ && !uring_->HasFeature(IORING_FEAT_SUBMIT_STABLE)) {
+    WaitForIoUringSends();
+  }
+#endif
+
+  BuildPackets(data, data_size, frame_sequence, total_packets);
+
+  const uint64_t syscalls_before = stats_.syscalls;
+  const uint64_t copied_before = stats_.bytes_copied;
+  int flags = 0;
+  int ret = 0;
+#ifdef __linux__
+  // Keep the error queue drained and release buffers of earlier frames
+  ReapZeroCopyCompletions();
+
+  if (zerocopy_enabled_ && send_mode_ != SendMode::kIoUring &&
+      data_size >= zerocopy_threshold_) {
+    flags |= MSG_ZEROCOPY;
+    // Registered before sending so completions that arrive while the frame
+    // is still being sent are accounted to it
+    inflight_buffers_.push_back(
+        {data, frame_sequence, stats_.zerocopy_sends, stats_.zerocopy_sends, 0, true});
+    stats_.zerocopy_frames++;
+  }
+
+  if (send_mode_ == SendMode::kSegmented) {
+    ret = SendPacketsSegmented(total_packets, flags);
+  } else if (send_mode_ == SendMode::kBatched) {
+    ret = SendPacketsBatched(0, total_packets, flags);
+#ifdef HAVE_IO_URING
+  } else if (send_mode_ == SendMode::kIoUring) {
+    ret = SendPacketsIoUring(data, frame_sequence, total_packets);
+#endif
+  } else {
+    ret = SendPacketsIndividually(0, total_packets, flags);
+  }
+
+  if (flags & MSG_ZEROCOPY) {
+    InFlightBuffer& inflight = inflight_buffers_.back();
+    inflight.sending = false;
+    if (inflight.remaining == 0) {
+      inflight_buffers_.pop_back();
+    } else {
+      // The kernel reads the headers like the payload
+      RetireHeaderPool(&inflight);
+    }
+  }
+#else
+  ret = SendPacketsIndividually(0, total_packets, flags);
+#endif
+  if (ret != 0) {
+    LOG(ERROR) << "[MessageSender] Failed to send frame " << frame_sequence;
+    return ret;
+  }
+
+  stats_.frames_sent++;
+  stats_.last_frame_syscalls =
+      static_cast<uint32_t>(stats_.syscalls - syscalls_before);
+  stats_.last_frame_bytes_copied = stats_.bytes_copied - copied_before;
+
+  LOG(INFO) << "[MessageSender] Successfully sent frame " << frame_sequence
+            << " in " << total_packets << " packets, "
+            << stats_.last_frame_syscalls << " syscalls, "
+            << stats_.last_frame_bytes_copied << " bytes copied";
+
+  return 0;
+}
+
+void MessageSender::BuildPackets(const uint8_t* data, size_t data_size,
+                                 uint32_t frame_sequence,
+                                 uint16_t total_packets) {
+  const size_t max_payload_size = max_packet_size_ - sizeof(PacketHeader);
+
+  // Only grows, so steady state sending does not allocate
+  if (header_pool_.size() < total_packets) {
+    header_pool_.resize(total_packets);
+    packet_iovecs_.resize(2 * static_cast<size_t>(total_packets));
+  }
 
-  // Send data in chunks
   size_t offset = 0;
   for (uint16_t packet_index = 0; packet_index < total_packets; packet_index++) {
     // Calculate payload size for this packet
     size_t remaining = data_size - offset;
     size_t payload_size = (remaining > max_payload_size) ? max_payload_size : remaining;
 
-    // Prepare packet with header
-    uint8_t* packet = packet_buffer.data();
-    PacketHeader* header = reinterpret_cast<PacketHeader*>(packet);
-    header->frame_sequence = htonl(frame_sequence);
-    header->packet_index = htons(packet_index);
-    header->total_packets = htons(total_packets);
-    header->payload_size = htonl(static_cast<uint32_t>(payload_size));
+    PacketHeader& header = header_pool_[packet_index];
+    header.frame_sequence = htonl(frame_sequence);
+    header.packet_index = htons(packet_index);
+    header.total_packets = htons(total_packets);
+    header.payload_size = htonl(static_cast<uint32_t>(payload_size));
+
+    // Header from the pool, payload read in place from the caller's buffer
+    struct iovec* iov = &packet_iovecs_[2 * static_cast<size_t>(packet_index)];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(PacketHeader);
+    iov[1].iov_base = const_cast<uint8_t*>(data + offset);
+    iov[1].iov_len = payload_size;
 
-    // Copy payload
-    memcpy(packet + header_size, data + offset, payload_size);
+    offset += payload_size;
+  }
+}
 
-    // Send packet
-    size_t packet_size = header_size + payload_size;
-    int ret = SendPacket(packet, packet_size);
-    if (ret != 0) {
-      LOG(ERROR) << "[MessageSender] Failed to send packet " << packet_index
-                 << " of frame " << frame_sequence;
-      return ret;
+void MessageSender::RetireHeaderPool(InFlightBuffer* inflight) {
+  inflight->headers = std::move(header_pool_);
+  if (spare_header_pools_.empty()) {
+    // BuildPackets sizes it
+    header_pool_ = std::vector<PacketHeader>();
+  } else {
+    header_pool_ = std::move(spare_header_pools_.back());
+    spare_header_pools_.pop_back();
+  }
+}
+
+void MessageSender::ReleaseCompletedFrames(std::deque<InFlightBuffer>* frames) {
+  for (auto it = frames->begin(); it != frames->end();) {
+    if (it->remaining > 0 || it->sending) {
+      ++it;
+      continue;
+    }
+    if (!it->headers.empty()) {
+      spare_header_pools_.push_back(std::move(it->headers));
     }
+    it = frames->erase(it);
+  }
+}
 
-    offset += payload_size;
+int MessageSender::SendPacketsIndividually(uint16_t first_packet,
+                                           uint16_t total_packets, int flags) {
+  uint16_t packet_index = first_packet;
+  while (packet_index < total_packets) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &packet_iovecs_[2 * static_cast<size_t>(packet_index)];
+    msg.msg_iovlen = 2;
+
+    stats_.syscalls++;
+    ssize_t bytes_sent = sendmsg(socket_fd_, &msg, flags);
+    if (bytes_sent < 0) {
+#ifdef __linux__
+      if (RecoverFromZeroCopyNoBufs(flags)) {
+        continue;
+      }
+#endif
+      LOG(ERROR) << "[MessageSender] sendmsg() failed for packet "
+                 << packet_index << ": " << strerror(errno);
+      return -1;
+    }
+#ifdef __linux__
+    CountZeroCopySends(flags, 1);
+#endif
+    stats_.packets_sent++;
+    stats_.bytes_sent += static_cast<size_t>(bytes_sent);
+    packet_index++;
   }
 
-  LOG(INFO) << "[MessageSender] Successfully sent frame " << frame_sequence
-            << " in " << total_packets << " packets";
+  return 0;
+}
+
+#ifdef __linux__
+int MessageSender::SendPacketsBatched(uint16_t first_packet,
+                                      uint16_t total_packets, int flags) {
+  if (batch_msgs_.size() < total_packets) {
+    batch_msgs_.resize(total_packets);
+  }
+
+  // Describe every packet of the frame in one mmsghdr array
+  for (uint16_t packet_index = first_packet; packet_index < total_packets;
+       packet_index++) {
+    struct mmsghdr& msg = batch_msgs_[packet_index];
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_hdr.msg_iov = &packet_iovecs_[2 * static_cast<size_t>(packet_index)];
+    msg.msg_hdr.msg_iovlen = 2;
+  }
+
+  // sendmmsg() may send fewer messages than requested (and caps vlen at
+  // UIO_MAXIOV), so keep flushing until the whole frame is out
+  unsigned int sent = first_packet;
+  while (sent < total_packets) {
+    unsigned int count = std::min<unsigned int>(total_packets - sent, UIO_MAXIOV);
+    stats_.syscalls++;
+    int ret = sendmmsg(socket_fd_, &batch_msgs_[sent], count, flags);
+    if (ret < 0) {
+      if (errno == EINTR || RecoverFromZeroCopyNoBufs(flags)) {
+        continue;
+      }
+      LOG(ERROR) << "[MessageSender] sendmmsg() failed: " << strerror(errno);
+      return -1;
+    }
+    CountZeroCopySends(flags, static_cast<uint64_t>(ret));
+    for (int i = 0; i < ret; i++) {
+      stats_.bytes_sent += batch_msgs_[sent + i].msg_len;
+    }
+    stats_.packets_sent += ret;
+    sent += ret;
+  }
 
   return 0;
 }
 
+int MessageSender::SendPacketsSegmented(uint16_t total_packets, int flags) {
+  // The kernel accepts at most 64 segments and one maximum-sized UDP datagram
+  // (65507 bytes of IPv4 payload) per GSO send
+  const size_t kMaxGsoSegments = 64;
+  const size_t kMaxGsoBytes = 65507;
+  // With MSG_ZEROCOPY every iovec (and every page it crosses) becomes an skb
+  // fragment, limited to MAX_SKB_FRAGS (17). A header/payload pair needs at
+  // most 3 fragments.
+  const size_t kMaxZeroCopyGsoSegments = 5;
+  const uint16_t segments_per_send = static_cast<uint16_t>(
+      std::min((flags & MSG_ZEROCOPY) ? kMaxZeroCopyGsoSegments : kMaxGsoSegments,
+               kMaxGsoBytes / max_packet_size_));
+
+  uint16_t gso_size = static_cast<uint16_t>(max_packet_size_);
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))];
+
+  uint16_t packet_index = 0;
+  while (packet_index < total_packets) {
+    uint16_t count = std::min<uint16_t>(total_packets - packet_index,
+                                        segments_per_send);
+
+    // Header/payload iovec pairs of consecutive packets form one buffer of
+    // max_packet_size_ segments
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &packet_iovecs_[2 * static_cast<size_t>(packet_index)];
+    msg.msg_iovlen = 2 * static_cast<size_t>(count);
+
+    // A single datagram does not need segmentation
+    if (count > 1) {
+      memset(control, 0, sizeof(control));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+    }
+
+    stats_.syscalls++;
+    ssize_t bytes_sent = sendmsg(socket_fd_, &msg, flags);
+    if (bytes_sent < 0) {
+      if (errno == EINTR || RecoverFromZeroCopyNoBufs(flags)) {
+        continue;
+      }
+      // EIO: the egress device cannot checksum-offload segmented packets.
+      // Give up on GSO for this socket and send the rest with sendmmsg.
+      if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT) {
+        LOG(WARNING) << "[MessageSender] UDP GSO send rejected ("
+                     << strerror(errno) << "), falling back to sendmmsg";
+        send_mode_ = SendMode::kBatched;
+        return SendPacketsBatched(packet_index, total_packets, flags);
+      }
+      LOG(ERROR) << "[MessageSender] sendmsg() failed: " << strerror(errno);
+      return -1;
+    }
+
+    CountZeroCopySends(flags, 1);
+    stats_.packets_sent += count;
+    stats_.bytes_sent += static_cast<size_t>(bytes_sent);
+    packet_index += count;
+  }
+
+  return 0;
+}
+
+bool MessageSender::EnableZeroCopy() {
+  int one = 1;
+  if (setsockopt(socket_fd_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+    LOG(WARNING) << "[MessageSender] SO_ZEROCOPY not supported ("
+                 << strerror(errno) << "), sending with copies";
+    return false;
+  }
+  return true;
+}
+
+void MessageSender::CountZeroCopySends(int flags, uint64_t count) {
+  if (!(flags & MSG_ZEROCOPY) || count == 0) {
+    return;
+  }
+  // The kernel numbers successful MSG_ZEROCOPY send calls from 0 per socket
+  stats_.zerocopy_sends += count;
+  InFlightBuffer& inflight = inflight_buffers_.back();
+  inflight.last_id = stats_.zerocopy_sends - 1;
+  inflight.remaining += count;
+}
+
+bool MessageSender::RecoverFromZeroCopyNoBufs(int flags) {
+  if (!(flags & MSG_ZEROCOPY) || errno != ENOBUFS) {
+    return false;
+  }
+  // Out of optmem for notifications or pinned pages: wait for the kernel to
+  // complete earlier sends, then retry
+  struct pollfd pfd;
+  pfd.fd = socket_fd_;
+  pfd.events = 0;  // Error queue readiness is reported as POLLERR
+  pfd.revents = 0;
+  if (poll(&pfd, 1, 100) <= 0) {
+    return false;
+  }
+  ReapZeroCopyCompletions();
+  return true;
+}
+#endif
+
+#ifdef HAVE_IO_URING
+int MessageSender::SendPacketsIoUring(const uint8_t* data, uint32_t frame_sequence,
+                                      uint16_t total_packets) {
+  if (batch_msgs_.size() < total_packets) {
+    batch_msgs_.resize(total_packets);
+  }
+
+  // Registered before queueing so completions reaped meanwhile are
+  // accounted to it
+  uring_frames_.push_back({data, frame_sequence, 0, 0, 0, true});
+  int ret = 0;
+  for (uint16_t packet_index = 0; packet_index < total_packets; packet_index++) {
+    struct msghdr& msg = batch_msgs_[packet_index].msg_hdr;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &packet_iovecs_[2 * static_cast<size_t>(packet_index)];
+    msg.msg_iovlen = 2;
+
+    // Completions are not consumed while queueing, keep them within the CQ
+    if (uring_pending_ >= uring_->GetCompletionQueueSize()) {
+      if (SubmitIoUring(1, "while waiting for completions") < 0) {
+        ret = -1;
+        break;
+      }
+      ReapIoUringCompletions();
+    }
+    struct io_uring_sqe* sqe = uring_->GetSqe();
+    if (sqe == nullptr) {
+      // Submission queue full: hand the queued packets to the kernel
+      if (SubmitIoUring(0, "of a full submission queue") < 0) {
+        ret = -1;
+        break;
+      }
+      sqe = uring_->GetSqe();
+      if (sqe == nullptr) {
+        LOG(ERROR) << "[MessageSender] io_uring submission queue still full";
+        ret = -1;
+        break;
+      }
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = socket_fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&msg);
+    sqe->len = 1;
+    sqe->user_data = (static_cast<uint64_t>(frame_sequence) << 16) | packet_index;
+    uring_pending_++;
+    uring_frames_.back().remaining++;
+  }
+
+  if (ret == 0 && SubmitIoUring(0, "of the frame") < 0) {
+    ret = -1;
+  }
+
+  InFlightBuffer& frame = uring_frames_.back();
+  frame.sending = false;
+  if (frame.remaining == 0) {
+    uring_frames_.pop_back();
+  } else {
+    // The kernel reads the headers when it gets to the sends
+    RetireHeaderPool(&frame);
+  }
+  return ret;
+}
+
+int MessageSender::SubmitIoUring(unsigned wait_nr, const char* step) {
+  const uint64_t enter_calls = uring_->GetStats().enter_calls;
+  int ret = uring_->Submit(wait_nr);
+  stats_.syscalls += uring_->GetStats().enter_calls - enter_calls;
+  if (ret < 0) {
+    LOG(ERROR) << "[MessageSender] io_uring submit " << step << " failed: "
+               << strerror(-ret);
+  }
+  return ret;
+}
+
+void MessageSender::ReapIoUringCompletions() {
+  struct io_uring_cqe cqe;
+  while (uring_pending_ > 0 && uring_->PopCompletion(&cqe)) {
+    uring_pending_--;
+    const uint32_t frame_sequence = static_cast<uint32_t>(cqe.user_data >> 16);
+    for (InFlightBuffer& frame : uring_frames_) {
+      if (frame.frame_sequence == frame_sequence && frame.remaining > 0) {
+        frame.remaining--;
+        break;
+      }
+    }
+    if (cqe.res < 0) {
+      LOG(WARNING) << "[MessageSender] io_uring sendmsg failed for frame "
+                   << frame_sequence << " packet " << (cqe.user_data & 0xffff) << ": "
+                   << strerror(-cqe.res);
+      continue;
+    }
+    stats_.packets_sent++;
+    stats_.bytes_sent += static_cast<uint64_t>(cqe.res);
+  }
+  ReleaseCompletedFrames(&uring_frames_);
+}
+
+void MessageSender::WaitForIoUringSends() {
+  if (!uring_) {
+    return;
+  }
+  ReapIoUringCompletions();
+  while (uring_pending_ > 0) {
+    if (SubmitIoUring(uring_pending_, "while waiting for sends") < 0) {
+      // Nothing more will complete
+      uring_pending_ = 0;
+      for (InFlightBuffer& frame : uring_frames_) {
+        frame.remaining = 0;
+      }
+      ReleaseCompletedFrames(&uring_frames_);
+      return;
+    }
+    ReapIoUringCompletions();
+  }
+}
+#endif
+
+void MessageSender::ReapZeroCopyCompletions() {
+#ifdef __linux__
+  if (socket_fd_ < 0) {
+    return;
+  }
+
+  while (!inflight_buffers_.empty()) {
+    alignas(struct cmsghdr) char control[CMSG_SPACE(
+        sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(socket_fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      break;  // EAGAIN: no more notifications
+    }
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR) {
+        continue;
+      }
+      struct sock_extended_err serr;
+      memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+      if (serr.ee_errno != 0 || serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+
+      // Notification covers the 32-bit id range [ee_info, ee_data]; widen it
+      // relative to the oldest frame still in flight
+      const uint64_t base = inflight_buffers_.front().first_id;
+      const uint64_t lo = base + static_cast<uint32_t>(
+                                     serr.ee_info - static_cast<uint32_t>(base));
+      const uint64_t hi = lo + static_cast<uint32_t>(serr.ee_data - serr.ee_info);
+      stats_.zerocopy_completed += hi - lo + 1;
+      if (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        stats_.zerocopy_copied += hi - lo + 1;
+      }
+
+      for (InFlightBuffer& inflight : inflight_buffers_) {
+        if (inflight.remaining == 0) {
+          continue;
+        }
+        uint64_t first = std::max(lo, inflight.first_id);
+        uint64_t last = std::min(hi, inflight.last_id);
+        if (first <= last) {
+          inflight.remaining -= std::min(inflight.remaining, last - first + 1);
+        }
+      }
+    }
+
+    ReleaseCompletedFrames(&inflight_buffers_);
+  }
+#endif
+}
+
+bool MessageSender::IsBufferInFlight(const uint8_t* buffer) const {
+#ifdef HAVE_IO_URING
+  for (const InFlightBuffer& frame : uring_frames_) {
+    if (frame.buffer == buffer) {
+      return true;
+    }
+  }
+#endif
+  for (const InFlightBuffer& inflight : inflight_buffers_) {
+    if (inflight.buffer == buffer) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int MessageSender::WaitForBufferRelease(const uint8_t* buffer, int timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(timeout_ms);
+#ifdef HAVE_IO_URING
+  // Local sends complete quickly, so just wait for all of them
+  if (!uring_frames_.empty() && IsBufferInFlight(buffer)) {
+    WaitForIoUringSends();
+  }
+#endif
+  ReapZeroCopyCompletions();
+  while (IsBufferInFlight(buffer)) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      LOG(WARNING) << "[MessageSender] Timed out waiting for MSG_ZEROCOPY "
+                      "completions";
+      return -1;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = 0;  // Error queue readiness is reported as POLLERR
+    pfd.revents = 0;
+    if (poll(&pfd, 1, static_cast<int>(remaining.count())) < 0 &&
+        errno != EINTR) {
+      LOG(ERROR) << "[MessageSender] poll() failed: " << strerror(errno);
+      return -1;
+    }
+    ReapZeroCopyCompletions();
+  }
+  return 0;
+}
+
 int MessageSender::SendRaw(const uint8_t* data, size_t data_size) {
   if (!initialized_ || socket_fd_ < 0) {
     LOG(ERROR) << "[MessageSender] Not initialized";
@@ -163,7 +792,40 @@ int MessageSender::SendPacket(const uint8_t* packet_data, size_t packet_size) {
   return 0;
 }
 
+void MessageSender::PrintStats() const {
+  double syscalls_per_frame =
+      stats_.frames_sent ? static_cast<double>(stats_.syscalls) / stats_.frames_sent : 0.0;
+  double packets_per_syscall =
+      stats_.syscalls ? static_cast<double>(stats_.packets_sent) / stats_.syscalls : 0.0;
+  LOG(INFO) << "[MessageSender] Stats: mode=" << SendModeName(send_mode_)
+            << " frames=" << stats_.frames_sent
+            << " packets=" << stats_.packets_sent
+            << " bytes=" << stats_.bytes_sent
+            << " syscalls=" << stats_.syscalls
+            << " syscalls/frame=" << syscalls_per_frame
+            << " packets/syscall=" << packets_per_syscall
+            << " bytes_copied=" << stats_.bytes_copied
+            << " zerocopy_frames=" << stats_.zerocopy_frames
+            << " zerocopy_sends=" << stats_.zerocopy_sends
+            << " zerocopy_copied=" << stats_.zerocopy_copied;
+}
+
 void MessageSender::Close() {
+  // Give outstanding MSG_ZEROCOPY sends a chance to complete before the
+  // caller frees their buffers
+  while (!inflight_buffers_.empty() && socket_fd_ >= 0) {
+    if (WaitForBufferRelease(inflight_buffers_.front().buffer, 100) != 0) {
+      break;
+    }
+  }
+  inflight_buffers_.clear();
+  zerocopy_enabled_ = false;
+#ifdef HAVE_IO_URING
+  WaitForIoUringSends();
+  uring_frames_.clear();
+  uring_.reset();
+#endif
+
   if (socket_fd_ >= 0) {
     close(socket_fd_);
     socket_fd_ = -1;
@@ -2,7 +2,49 @@
 #define TRANSMISSION_MESSAGE_SENDER_H
 
 #include <cstdint>
+#include <deque>
+#include <memory>
 #include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+#include "tools/io_uring_engine.h"
+#include "transmission/packet_header.h"
+
+// Transmit strategy used by MessageSender::SendData
+enum class SendMode {
+  kPerPacket,  // One send() syscall per packet
+  kBatched,    // All packets of a frame flushed with sendmmsg() (Linux only)
+  kSegmented,  // Whole frame in one sendmsg() with UDP_SEGMENT (Linux GSO)
+  kIoUring,    // Packets queued as io_uring sendmsg requests, submitted in
+               // one io_uring_enter() without waiting for completion
+};
+
+// Parse a send mode name ("packet", "batch", "gso", "uring")
+// Returns true on success, false if the name is unknown
+bool ParseSendMode(const std::string& name, SendMode* mode);
+
+// Get the name of a send mode
+const char* SendModeName(SendMode mode);
+
+// Transmission statistics collected by MessageSender
+struct SendStats {
+  uint64_t frames_sent = 0;         // Frames passed to SendData
+  uint64_t packets_sent = 0;        // Packets handed to the kernel
+  uint64_t bytes_sent = 0;          // Bytes handed to the kernel (incl. headers)
+  uint64_t syscalls = 0;            // Send syscalls issued by SendData
+  uint32_t last_frame_syscalls = 0; // Send syscalls issued for the last frame
+  // Payload bytes a send path copied in user space. Every mode sends the
+  // payload from the caller's buffer, so these stay 0; a path that ever
+  // copies (e.g. to linearize data) must add to them
+  uint64_t bytes_copied = 0;
+  uint64_t last_frame_bytes_copied = 0;  // Payload bytes copied for the last frame
+  uint64_t zerocopy_frames = 0;     // Frames sent with MSG_ZEROCOPY
+  uint64_t zerocopy_sends = 0;      // MSG_ZEROCOPY send calls issued
+  uint64_t zerocopy_completed = 0;  // MSG_ZEROCOPY send calls completed
+  uint64_t zerocopy_copied = 0;     // Completions where the kernel copied anyway
+};
 
 // MessageSender class for sending encoded video data over UDP
 // Splits large NAL units into smaller packets for transmission
@@ -15,6 +57,36 @@ class MessageSender {
   // Returns 0 on success, negative value on error
   int Initialize(const std::string& dest_ip, int dest_port, size_t max_packet_size = 1400);
 
+  // Select how SendData hands packets to the kernel
+  // Falls back to a supported mode (gso -> batch -> packet) if the platform
+  // or kernel rejects the requested one
+  void SetSendMode(SendMode mode);
+
+  // Get the active send mode
+  SendMode GetSendMode() const { return send_mode_; }
+
+  // Send frames of at least threshold bytes with MSG_ZEROCOPY (0 disables)
+  // Not applied in io_uring send mode
+  // The kernel then reads the payload from the caller's buffer after
+  // SendData returns, so the buffer must not be modified until
+  // IsBufferInFlight() turns false (see WaitForBufferRelease)
+  // The packet headers are referenced the same way, so each frame in flight
+  // keeps the header pool it was sent from and SendData continues with a
+  // spare one. Several frames may be in flight; callers bound how many by
+  // waiting for their buffers before reuse
+  void SetZeroCopyThreshold(size_t threshold);
+
+  // Read MSG_ZEROCOPY completion notifications from the socket error queue
+  // without blocking and release buffers whose sends have all completed
+  void ReapZeroCopyCompletions();
+
+  // Check if the kernel may still read from a buffer passed to SendData
+  bool IsBufferInFlight(const uint8_t* buffer) const;
+
+  // Block until the kernel no longer references buffer
+  // Returns 0 on success, negative value on timeout or error
+  int WaitForBufferRelease(const uint8_t* buffer, int timeout_ms = 1000);
+
   // Send encoded data (NAL unit)
   // Automatically splits large data into multiple packets
   // Returns 0 on success, negative value on error
@@ -30,17 +102,122 @@ class MessageSender {
   // Check if sender is initialized
   bool IsInitialized() const;
 
+  // Get transmission statistics
+  const SendStats& GetStats() const { return stats_; }
+
+  // Log transmission statistics (syscalls per frame, packets per syscall)
+  void PrintStats() const;
+
  private:
+  // Buffer referenced by MSG_ZEROCOPY or io_uring sends that have not
+  // completed yet
+  struct InFlightBuffer {
+    const uint8_t* buffer;
+    uint32_t frame_sequence;
+    uint64_t first_id;   // First zerocopy notification id of the frame
+    uint64_t last_id;    // Last zerocopy notification id of the frame
+    uint64_t remaining;  // Sends of this frame not yet completed
+    bool sending;        // SendData is still issuing sends for the frame
+    std::vector<PacketHeader> headers;  // Header pool the sends reference
+  };
+
   // Send a single packet
   int SendPacket(const uint8_t* packet_data, size_t packet_size);
 
+  // Fill a pooled header and a header/payload iovec pair for every packet
+  // of a frame. Payload iovecs point into data, which must stay valid until
+  // the frame has been sent.
+  void BuildPackets(const uint8_t* data, size_t data_size,
+                    uint32_t frame_sequence, uint16_t total_packets);
+
+  // Hand the header pool to a frame whose sends still reference it and
+  // continue with a spare one
+  void RetireHeaderPool(InFlightBuffer* inflight);
+
+  // Drop frames whose sends have all completed, keeping their header pools
+  // as spares
+  void ReleaseCompletedFrames(std::deque<InFlightBuffer>* frames);
+
+  // Check that the requested mode works on this socket, returning the mode
+  // to use instead if it does not
+  SendMode ResolveSendMode(SendMode mode);
+
+  // Send packets [first_packet, total_packets) prepared by BuildPackets,
+  // one sendmsg() per packet. flags are passed to the send syscalls.
+  int SendPacketsIndividually(uint16_t first_packet, uint16_t total_packets,
+                              int flags);
+
+#ifdef __linux__
+  // Send packets [first_packet, total_packets) with sendmmsg()
+  int SendPacketsBatched(uint16_t first_packet, uint16_t total_packets,
+                         int flags);
+
+  // Send packets with sendmsg() + UDP_SEGMENT, letting the kernel split the
+  // buffer into max_packet_size_ datagrams. Falls back to SendPacketsBatched
+  // for the rest of the frame if the kernel rejects GSO at send time.
+  int SendPacketsSegmented(uint16_t total_packets, int flags);
+
+  // Enable SO_ZEROCOPY on the socket, returns false if unsupported
+  bool EnableZeroCopy();
+
+  // Account for count successful send calls issued with flags
+  void CountZeroCopySends(int flags, uint64_t count);
+
+  // Handle ENOBUFS from a MSG_ZEROCOPY send (pinned page limit reached) by
+  // waiting for outstanding completions. Returns true if the send should be
+  // retried.
+  bool RecoverFromZeroCopyNoBufs(int flags);
+#endif
+
+#ifdef HAVE_IO_URING
+  // Queue one sendmsg request per packet and submit them with a single
+  // io_uring_enter(). The frame's payload and headers stay in flight until
+  // the completions are reaped (see WaitForBufferRelease), while later
+  // frames are queued behind it.
+  int SendPacketsIoUring(const uint8_t* data, uint32_t frame_sequence,
+                         uint16_t total_packets);
+
+  // Submit queued requests and wait for wait_nr completions, logging step
+  // on failure
+  // Returns the number of requests submitted, negative errno on error
+  int SubmitIoUring(unsigned wait_nr, const char* step);
+
+  // Account for completed io_uring sends without blocking
+  void ReapIoUringCompletions();
+
+  // Block until every queued io_uring send has completed
+  void WaitForIoUringSends();
+
+  std::unique_ptr<IoUringEngine> uring_;
+  std::deque<InFlightBuffer> uring_frames_;  // Frames with sends pending
+  uint32_t uring_pending_;                   // Sends queued but not completed
+#endif
+
   int socket_fd_;
   std::string dest_ip_;
   int dest_port_;
   size_t max_packet_size_;
   bool initialized_;
   uint32_t packet_sequence_;
+  SendMode send_mode_;
+  SendMode requested_send_mode_;
+  size_t zerocopy_threshold_;
+  bool zerocopy_enabled_;
+
+  // Frames whose MSG_ZEROCOPY sends are still pending, oldest first
+  std::deque<InFlightBuffer> inflight_buffers_;
+
+  // Per-packet header pool and header/payload iovec pairs, preallocated in
+  // Initialize and grown only for frames larger than any seen before
+  std::vector<PacketHeader> header_pool_;
+  // Header pools of completed frames, reused by RetireHeaderPool
+  std::vector<std::vector<PacketHeader>> spare_header_pools_;
+  std::vector<struct iovec> packet_iovecs_;
+#ifdef __linux__
+  std::vector<struct mmsghdr> batch_msgs_;
+#endif
+
+  SendStats stats_;
 };
 
 #endif  // TRANSMISSION_MESSAGE_SENDER_H
-
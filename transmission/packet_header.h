@@ -4,6 +4,9 @@
 #include <cstdint>
 
 // Packet header structure (sent before payload)
+// Every packet of a frame except the last is exactly max_packet_size bytes
+// (header + full payload), so a packetized frame is a sequence of fixed-size
+// segments that can be handed to UDP GSO as one buffer.
 struct PacketHeader {
   uint32_t frame_sequence;  // Frame sequence number
   uint16_t packet_index;    // Packet index within frame (0-based)
@@ -11,4 +14,6 @@ struct PacketHeader {
   uint32_t payload_size;    // Size of payload in this packet
 };
 
+static_assert(sizeof(PacketHeader) == 12, "PacketHeader is a wire format");
+
 #endif  // TRANSMISSION_PACKET_HEADER_H
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "sharded_message_receiver.h"
+
+#include "log_system/log_system.h"
+
+ShardedMessageReceiver::ShardedMessageReceiver() {}
+
+ShardedMessageReceiver::~ShardedMessageReceiver() { Close(); }
+
+int ShardedMessageReceiver::Initialize(int listen_port, int num_shards,
+                                       size_t batch_size, bool gro,
+                                       bool io_uring,
+                                       std::chrono::microseconds busy_poll) {
+  if (!shards_.empty()) {
+    LOG(WARNING) << "[ShardedMessageReceiver] Already initialized";
+    return 0;
+  }
+
+  if (num_shards < 1) {
+    LOG(ERROR) << "[ShardedMessageReceiver] Invalid shard count: " << num_shards;
+    return -1;
+  }
+
+  // All sockets join the reuseport group before any traffic arrives, so the
+  // flow-to-shard mapping stays fixed for the whole session
+  for (int i = 0; i < num_shards; i++) {
+    auto shard = std::make_unique<MessageReceiver>();
+    shard->SetReusePort(true);
+    shard->SetReceiveBatchSize(batch_size);
+    shard->SetGroEnabled(gro);
+    shard->SetIoUringEnabled(io_uring);
+    shard->SetBusyPoll(busy_poll);
+    if (shard->Initialize(listen_port) != 0) {
+      LOG(ERROR) << "[ShardedMessageReceiver] Failed to initialize shard " << i;
+      Close();
+      return -1;
+    }
+    shards_.push_back(std::move(shard));
+  }
+
+  LOG(INFO) << "[ShardedMessageReceiver] Initialized " << num_shards
+            << " shards on port " << listen_port;
+  return 0;
+}
+
+MessageReceiver* ShardedMessageReceiver::GetShard(int shard_index) {
+  if (shard_index < 0 || shard_index >= GetShardCount()) {
+    return nullptr;
+  }
+  return shards_[shard_index].get();
+}
+
+void ShardedMessageReceiver::Run() {
+  std::vector<Thread> threads(shards_.size());
+  for (size_t i = 0; i < shards_.size(); i++) {
+    MessageReceiver* shard = shards_[i].get();
+    threads[i].Start([shard]() { shard->Run(); });
+  }
+
+  for (Thread& thread : threads) {
+    thread.Join();
+  }
+
+  LOG(INFO) << "[ShardedMessageReceiver] All shards stopped";
+}
+
+void ShardedMessageReceiver::Stop() {
+  for (auto& shard : shards_) {
+    shard->Stop();
+  }
+}
+
+void ShardedMessageReceiver::Close() {
+  for (auto& shard : shards_) {
+    shard->Close();
+  }
+  shards_.clear();
+}
+
+void ShardedMessageReceiver::PrintStats() const {
+  for (const auto& shard : shards_) {
+    shard->PrintStats();
+  }
+}
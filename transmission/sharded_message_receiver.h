@@ -0,0 +1,54 @@
+#ifndef TRANSMISSION_SHARDED_MESSAGE_RECEIVER_H
+#define TRANSMISSION_SHARDED_MESSAGE_RECEIVER_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "tools/thread_manager.h"
+#include "transmission/message_handler.h"
+#include "transmission/message_receiver.h"
+
+// ShardedMessageReceiver runs N MessageReceivers bound to the same port with
+// SO_REUSEPORT, each on its own thread.
+// The kernel picks the shard by hashing the flow 4-tuple, so all packets of
+// one stream (one sender socket) land on the same shard. Each shard has its
+// own MessageHandler and therefore its own frame assembly state, so shards
+// never share data or locks.
+class ShardedMessageReceiver {
+ public:
+  ShardedMessageReceiver();
+  ~ShardedMessageReceiver();
+
+  // Bind num_shards sockets to listen_port
+  // batch_size, gro, io_uring and busy_poll configure every shard (see
+  // MessageReceiver); busy polling keeps one core spinning per shard
+  // Returns 0 on success, negative value on error
+  int Initialize(int listen_port, int num_shards, size_t batch_size, bool gro,
+                 bool io_uring = false,
+                 std::chrono::microseconds busy_poll = std::chrono::microseconds(0));
+
+  // Get the number of shards
+  int GetShardCount() const { return static_cast<int>(shards_.size()); }
+
+  // Get a shard's receiver (to set its handler or query its sender)
+  MessageReceiver* GetShard(int shard_index);
+
+  // Run every shard on its own thread (blocks until all shards stop)
+  void Run();
+
+  // Stop all shards
+  void Stop();
+
+  // Close all shard sockets
+  void Close();
+
+  // Log receive statistics of every shard
+  void PrintStats() const;
+
+ private:
+  std::vector<std::unique_ptr<MessageReceiver>> shards_;
+};
+
+#endif  // TRANSMISSION_SHARDED_MESSAGE_RECEIVER_H